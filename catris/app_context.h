@@ -3,10 +3,13 @@
 
 #include "ecs.h"
 #include "scene.h"
+#include "scheduler.h"
 #include "hash.h"
+#include "sprite_batch.h"
 
 typedef struct {
 	unsigned int programID;
+	unsigned int projectionTick; // camera change tick the projection uniform was last uploaded at
 } ShaderManager;
 
 typedef struct {
@@ -23,7 +26,10 @@ typedef struct {
 	ShaderManager* shaderManager;
 	SceneManager* sceneManager;
 	TextureManager* textureManager;
+	Scheduler* scheduler;
+	SpriteBatch* spriteBatch;
 	EntityID activeCameraId;
+	QueryID spriteQuery; // MODEL | VERTEX | TEXTURE | SPRITE, drawn by render_sprites_system
 } ApplicationContext;
 
 char* readShaderSource(const char* filePath);
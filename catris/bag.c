@@ -0,0 +1,46 @@
+#include "bag.h"
+
+static void bag_fill(PieceBag *bag, Rng *rng) {
+	uint8_t shapes[TETROMINO_COUNT];
+
+	for (int i = 0; i < TETROMINO_COUNT; i++) {
+		shapes[i] = (uint8_t)i;
+	}
+
+	// Fisher-Yates
+	for (int i = TETROMINO_COUNT - 1; i > 0; i--) {
+		int j = (int)rng_range(rng, (uint32_t)(i + 1));
+		uint8_t tmp = shapes[i];
+		shapes[i] = shapes[j];
+		shapes[j] = tmp;
+	}
+
+	for (int i = 0; i < TETROMINO_COUNT; i++) {
+		bag->pieces[(bag->head + bag->count) % BAG_CAPACITY] = shapes[i];
+		bag->count++;
+	}
+}
+
+void bag_init(PieceBag *bag, Rng *rng) {
+	bag->head = 0;
+	bag->count = 0;
+	bag_fill(bag, rng);
+	bag_fill(bag, rng);
+}
+
+TetrominoShape bag_next(PieceBag *bag, Rng *rng) {
+	TetrominoShape shape = (TetrominoShape)bag->pieces[bag->head];
+
+	bag->head = (uint8_t)((bag->head + 1) % BAG_CAPACITY);
+	bag->count--;
+
+	if (bag->count < TETROMINO_COUNT) {
+		bag_fill(bag, rng);
+	}
+
+	return shape;
+}
+
+TetrominoShape bag_peek(const PieceBag *bag, int index) {
+	return (TetrominoShape)bag->pieces[(bag->head + index) % BAG_CAPACITY];
+}
\ No newline at end of file
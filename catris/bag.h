@@ -0,0 +1,25 @@
+#ifndef BAG_H
+#define BAG_H
+
+#include <stdint.h>
+
+#include "rng.h"
+#include "tetromino.h"
+
+// 7-bag randomizer: every shape once per bag, a whole shuffled bag is appended at a time
+// so at least one full bag of upcoming pieces can always be previewed
+
+#define BAG_CAPACITY (2 * TETROMINO_COUNT)
+
+typedef struct {
+	uint8_t pieces[BAG_CAPACITY]; // ring buffer of upcoming shapes
+	uint8_t head;
+	uint8_t count;
+} PieceBag;
+
+void bag_init(PieceBag *bag, Rng *rng);
+TetrominoShape bag_next(PieceBag *bag, Rng *rng);
+// Upcoming shape, 0 is the one bag_next returns next, index must be below TETROMINO_COUNT
+TetrominoShape bag_peek(const PieceBag *bag, int index);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include <stdio.h>
+
+#include "board.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static int count_bits(uint32_t mask) {
+	int count = 0;
+	while (mask != 0) {
+		mask &= mask - 1;
+		count++;
+	}
+	return count;
+}
+
+static int highest_bit(uint32_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return (int)index;
+#else
+	return 31 - __builtin_clz(mask);
+#endif
+}
+
+static int lowest_bit(uint32_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Finds the topmost filled cell of every column, one pass over the rows for all columns
+static void update_heights(Board *board) {
+	uint32_t remaining = BOARD_FULL_ROW;
+
+	for (int row = 0; row < GRID_ROWS && remaining != 0; ++row) {
+		uint32_t found = board->rows[row] & remaining;
+		remaining &= ~found;
+
+		while (found != 0) {
+			board->colHeights[lowest_bit(found)] = (uint8_t)(GRID_ROWS - row);
+			found &= found - 1;
+		}
+	}
+
+	while (remaining != 0) {
+		board->colHeights[lowest_bit(remaining)] = 0;
+		remaining &= remaining - 1;
+	}
+}
+
+// Counts the newly filled cells in a row into the column counters
+static void add_cells(Board *board, int row, uint32_t added) {
+	while (added != 0) {
+		int col = lowest_bit(added);
+		board->colCounts[col]++;
+		if (board->colHeights[col] < GRID_ROWS - row) {
+			board->colHeights[col] = (uint8_t)(GRID_ROWS - row);
+		}
+		added &= added - 1;
+	}
+}
+
+// Refreshes the counters of one row after its bits changed
+static void update_row(Board *board, int row) {
+	int count = count_bits(board->rows[row] & BOARD_PLAYFIELD_ROW);
+
+	board->filledCells += count - board->rowCounts[row];
+	board->rowCounts[row] = (uint8_t)count;
+
+	if (count == BOARD_PLAYFIELD_COLS) {
+		board->fullRows |= 1u << row;
+	}
+	else {
+		board->fullRows &= ~(1u << row);
+	}
+}
+
+void board_init(Board *board) {
+	for (int row = 0; row < GRID_ROWS; ++row) {
+		board->rows[row] = BOARD_WALL_ROW;
+		board->rowCounts[row] = 0;
+	}
+	for (int col = 0; col < GRID_COLS; ++col) {
+		board->colCounts[col] = ((BOARD_WALL_ROW >> col) & 1u) ? GRID_ROWS : 0;
+	}
+	board->fullRows = 0;
+	board->filledCells = 0;
+	update_heights(board);
+}
+
+void board_recount(Board *board) {
+	board->fullRows = 0;
+	board->filledCells = 0;
+
+	for (int col = 0; col < GRID_COLS; ++col) {
+		board->colCounts[col] = 0;
+		for (int row = 0; row < GRID_ROWS; ++row) {
+			board->colCounts[col] += (board->rows[row] >> col) & 1u;
+		}
+	}
+
+	for (int row = 0; row < GRID_ROWS; ++row) {
+		board->rowCounts[row] = 0;
+		update_row(board, row);
+	}
+
+	update_heights(board);
+}
+
+bool board_is_empty(const Board *board) {
+	return board->filledCells == 0;
+}
+
+bool board_get_cell(const Board *board, int row, int col) {
+	if (row < 0 || row >= GRID_ROWS || col < 0 || col >= GRID_COLS) {
+		return 1;
+	}
+
+	return (board->rows[row] >> col) & 1u;
+}
+
+void board_set_cell(Board *board, int row, int col, bool filled) {
+	if (row < 0 || row >= GRID_ROWS || col < 0 || col >= GRID_COLS) {
+		printf("Error: Position (row: %d, col: %d) is out of grid bounds\n", row, col);
+		return;
+	}
+
+	if (((board->rows[row] >> col) & 1u) == (unsigned int)filled) {
+		return;
+	}
+
+	if (filled) {
+		board->rows[row] |= (BoardRow)(1u << col);
+		add_cells(board, row, 1u << col);
+	}
+	else {
+		board->rows[row] &= (BoardRow)~(1u << col);
+		board->colCounts[col]--;
+		if (board->colHeights[col] == GRID_ROWS - row) {
+			update_heights(board);
+		}
+	}
+	update_row(board, row);
+}
+
+bool board_row_is_full(const Board *board, int row) {
+	return (board->fullRows >> row) & 1u;
+}
+
+int board_find_highest_full_row(const Board *board) {
+	// "Highest" is the largest row index, i.e. the lowest row on screen
+	if (board->fullRows == 0) {
+		return -1;
+	}
+
+	return highest_bit(board->fullRows);
+}
+
+void board_remove_row(Board *board, int row) {
+	if (row < 0 || row >= GRID_ROWS) {
+		printf("Invalid row index. It must be between 0 and %d.\n", GRID_ROWS - 1);
+		return;
+	}
+
+	board->filledCells -= board->rowCounts[row];
+
+	uint32_t removed = board->rows[row] & BOARD_PLAYFIELD_ROW;
+	while (removed != 0) {
+		board->colCounts[lowest_bit(removed)]--;
+		removed &= removed - 1;
+	}
+
+	for (int r = row; r > 0; --r) {
+		board->rows[r] = board->rows[r - 1];
+		board->rowCounts[r] = board->rowCounts[r - 1];
+	}
+	board->rows[0] = BOARD_WALL_ROW;
+	board->rowCounts[0] = 0;
+
+	// Rows above the removed one move down by one
+	uint32_t above = board->fullRows & ((1u << row) - 1);
+	uint32_t below = board->fullRows & ~((2u << row) - 1);
+	board->fullRows = below | (above << 1);
+
+	update_heights(board);
+}
+
+// Removes every full row in a single sweep from the bottom up and returns how many were removed.
+// Up to max_rows removed indices are stored in cleared_rows, bottom row first, as they were before compaction.
+int board_clear_full_rows(Board *board, int *cleared_rows, int max_rows) {
+	int num_cleared = 0;
+
+	if (board->fullRows == 0) {
+		return 0;
+	}
+
+	// Rows below the lowest full row don't move
+	int write_row = highest_bit(board->fullRows);
+
+	for (int row = write_row; row >= 0; --row) {
+		if ((board->fullRows >> row) & 1u) {
+			if (num_cleared < max_rows) {
+				cleared_rows[num_cleared] = row;
+			}
+			num_cleared++;
+			continue;
+		}
+
+		board->rows[write_row] = board->rows[row];
+		board->rowCounts[write_row] = board->rowCounts[row];
+		write_row--;
+	}
+
+	while (write_row >= 0) {
+		board->rows[write_row] = BOARD_WALL_ROW;
+		board->rowCounts[write_row] = 0;
+		write_row--;
+	}
+
+	board->fullRows = 0;
+	board->filledCells -= num_cleared * BOARD_PLAYFIELD_COLS;
+
+	// Every cleared row had a cell in each playfield column
+	for (int col = BOARD_FIRST_PLAYFIELD_COL; col <= BOARD_LAST_PLAYFIELD_COL; ++col) {
+		board->colCounts[col] -= (uint8_t)num_cleared;
+	}
+	update_heights(board);
+
+	return num_cleared;
+}
+
+// Shifts a piece row horizontally, returns 0 when a set bit would leave the board
+static bool shift_piece_row(BoardRow piece_row, int col_offset, uint32_t *shifted) {
+	uint32_t mask = piece_row;
+
+	if (col_offset < 0) {
+		if (-col_offset >= 32 || (mask & ((1u << -col_offset) - 1)) != 0) {
+			return 0;
+		}
+		mask >>= -col_offset;
+	}
+	else if (col_offset > 0) {
+		if (col_offset >= 32 || (mask >> (32 - col_offset)) != 0) {
+			return 0;
+		}
+		mask <<= col_offset;
+	}
+
+	if ((mask & ~(uint32_t)BOARD_FULL_ROW) != 0) {
+		return 0;
+	}
+
+	*shifted = mask;
+	return 1;
+}
+
+bool board_piece_overlaps(const Board *board, const BoardRow piece[BOARD_PIECE_ROWS], int row, int col) {
+	// The whole box is inside the board columns, a plain AND per row is enough
+	if (col >= 0 && col <= GRID_COLS - BOARD_PIECE_ROWS) {
+		for (int i = 0; i < BOARD_PIECE_ROWS; ++i) {
+			if (piece[i] == 0) {
+				continue;
+			}
+
+			if (row + i < 0 || row + i >= GRID_ROWS || (board->rows[row + i] & (BoardRow)(piece[i] << col)) != 0) {
+				return 1;
+			}
+		}
+
+		return 0;
+	}
+
+	for (int i = 0; i < BOARD_PIECE_ROWS; ++i) {
+		uint32_t mask;
+
+		if (piece[i] == 0) {
+			continue;
+		}
+
+		if (row + i < 0 || row + i >= GRID_ROWS) {
+			return 1;
+		}
+
+		if (!shift_piece_row(piece[i], col, &mask)) {
+			return 1;
+		}
+
+		if ((board->rows[row + i] & mask) != 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void board_place_piece(Board *board, const BoardRow piece[BOARD_PIECE_ROWS], int row, int col) {
+	for (int i = 0; i < BOARD_PIECE_ROWS; ++i) {
+		uint32_t mask;
+
+		if (piece[i] == 0 || row + i < 0 || row + i >= GRID_ROWS) {
+			continue;
+		}
+
+		if (shift_piece_row(piece[i], col, &mask)) {
+			add_cells(board, row + i, mask & ~(uint32_t)board->rows[row + i]);
+			board->rows[row + i] |= (BoardRow)mask;
+			update_row(board, row + i);
+		}
+	}
+}
+
+int board_landing_row(const Board *board, const BoardRow piece[BOARD_PIECE_ROWS], int row, int col) {
+	int landing = GRID_ROWS;
+
+	// The lowest cell of each piece column has to stay above that column's surface
+	for (int box_col = 0; box_col < BOARD_PIECE_ROWS; ++box_col) {
+		int bottom = BOARD_PIECE_ROWS - 1;
+		while (bottom >= 0 && !((piece[bottom] >> box_col) & 1u)) {
+			bottom--;
+		}
+		if (bottom < 0) {
+			continue;
+		}
+
+		int board_col = col + box_col;
+		if (board_col < 0 || board_col >= GRID_COLS) {
+			return row;
+		}
+
+		int limit = GRID_ROWS - board->colHeights[board_col] - 1 - bottom;
+		if (limit < landing) {
+			landing = limit;
+		}
+	}
+
+	// Below an overhang the surface is above the piece, walk down instead
+	if (landing < row) {
+		landing = row;
+		while (!board_piece_overlaps(board, piece, landing + 1, col)) {
+			landing++;
+		}
+	}
+
+	return landing;
+}
+
+void board_print(const Board *board) {
+	// Print the top border
+	printf("+");
+	for (int col = 0; col < GRID_COLS; ++col) {
+		printf("---+");
+	}
+	printf("\n");
+
+	for (int row = 0; row < GRID_ROWS; ++row) {
+		printf("%2d |", row);
+
+		for (int col = 0; col < GRID_COLS; ++col) {
+			printf(" %u |", (board->rows[row] >> col) & 1u);
+		}
+		printf("\n");
+
+		printf("+");
+		for (int col = 0; col < GRID_COLS; ++col) {
+			printf("---+");
+		}
+		printf("\n");
+	}
+}
\ No newline at end of file
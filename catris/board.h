@@ -0,0 +1,62 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+// One bit per cell, bit N of a row is column N
+#if GRID_COLS <= 16
+typedef uint16_t BoardRow;
+#else
+typedef uint32_t BoardRow;
+#endif
+
+#define BOARD_FULL_ROW ((BoardRow)(0xFFFFFFFFu >> (32 - GRID_COLS)))
+
+// Columns outside of the playfield are pre-filled walls
+#define BOARD_FIRST_PLAYFIELD_COL 3
+#define BOARD_LAST_PLAYFIELD_COL 12
+#define BOARD_WALL_ROW ((BoardRow)(BOARD_FULL_ROW & ~(((1u << (BOARD_LAST_PLAYFIELD_COL + 1)) - 1) & ~((1u << BOARD_FIRST_PLAYFIELD_COL) - 1))))
+#define BOARD_PLAYFIELD_ROW ((BoardRow)(BOARD_FULL_ROW & ~BOARD_WALL_ROW))
+#define BOARD_PLAYFIELD_COLS (BOARD_LAST_PLAYFIELD_COL - BOARD_FIRST_PLAYFIELD_COL + 1)
+
+#if GRID_ROWS > 32
+#error "Board.fullRows keeps one bit per row"
+#endif
+
+// A piece is described by the row masks of its 4x4 box, top row first, bit N is box column N.
+// The box is placed with its top left corner at (row, col), cells outside the board always overlap.
+#define BOARD_PIECE_ROWS 4
+
+typedef struct {
+	BoardRow rows[GRID_ROWS];
+	// Kept up to date by every board_* write so line and perfect clear checks are O(1).
+	// Counts are playfield cells only, walls are not included.
+	uint8_t rowCounts[GRID_ROWS];
+	uint32_t fullRows; // bit N set when row N is full
+	int filledCells;
+	// Per column: rows from the bottom up to and including the topmost filled cell (0 when empty),
+	// and the number of filled cells. Wall columns are always GRID_ROWS.
+	uint8_t colHeights[GRID_COLS];
+	uint8_t colCounts[GRID_COLS];
+} Board;
+
+void board_init(Board *board);
+// Rebuilds the counters after rows were written directly
+void board_recount(Board *board);
+bool board_is_empty(const Board *board);
+bool board_get_cell(const Board *board, int row, int col);
+void board_set_cell(Board *board, int row, int col, bool filled);
+bool board_row_is_full(const Board *board, int row);
+int board_find_highest_full_row(const Board *board);
+void board_remove_row(Board *board, int row);
+int board_clear_full_rows(Board *board, int *cleared_rows, int max_rows);
+bool board_piece_overlaps(const Board *board, const BoardRow piece[BOARD_PIECE_ROWS], int row, int col);
+// Row a piece that fits at (row, col) ends up on when dropped straight down
+int board_landing_row(const Board *board, const BoardRow piece[BOARD_PIECE_ROWS], int row, int col);
+void board_place_piece(Board *board, const BoardRow piece[BOARD_PIECE_ROWS], int row, int col);
+void board_print(const Board *board);
+
+#endif
\ No newline at end of file
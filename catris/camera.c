@@ -16,10 +16,8 @@ EntityID createCamera(ECS *ecs) {
 	glm_ortho(cameraComponent.left, cameraComponent.right, cameraComponent.bottom, cameraComponent.top, 
 		cameraComponent.near, cameraComponent.far, cameraModel.model);
 
-	ecs->cameraComponents[cameraId] = cameraComponent;
-	ecs->modelComponent[cameraId] = cameraModel; 
-	ecs->entities[cameraId].componentMask |= COMPONENT_CAMERA;
-	ecs->entities[cameraId].componentMask |= COMPONENT_MODEL;
+	*(CameraComponent *)addComponent(ecs, cameraId, COMPONENT_TYPE_CAMERA) = cameraComponent;
+	*(ModelComponent *)addComponent(ecs, cameraId, COMPONENT_TYPE_MODEL) = cameraModel;
 
 	printf("%d entity", cameraId);
 	return cameraId;
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands.h"
+
+void initCommandBuffer(CommandBuffer* buffer) {
+	memset(buffer, 0, sizeof(CommandBuffer));
+}
+
+void freeCommandBuffer(CommandBuffer* buffer) {
+	free(buffer->commands);
+	free(buffer->data);
+	free(buffer->created);
+	initCommandBuffer(buffer);
+}
+
+static EcsCommand* pushCommand(CommandBuffer* buffer, EcsCommandType type, EntityID id) {
+	if (buffer->numCommands == buffer->commandCapacity) {
+		unsigned int capacity = buffer->commandCapacity ? buffer->commandCapacity * 2 : 64;
+		EcsCommand* commands = realloc(buffer->commands, capacity * sizeof(EcsCommand));
+		if (commands == NULL) {
+			printf("Error: Out of memory recording ECS command %d\n", type);
+			return NULL;
+		}
+		buffer->commands = commands;
+		buffer->commandCapacity = capacity;
+	}
+
+	EcsCommand* command = &buffer->commands[buffer->numCommands++];
+	command->type = type;
+	command->component = COMPONENT_TYPE_COUNT;
+	command->entity = id;
+	command->dataOffset = 0;
+	return command;
+}
+
+EntityID commandCreateEntity(CommandBuffer* buffer) {
+	if (buffer->numCreated == ECS_MAX_ENTITIES || pushCommand(buffer, ECS_COMMAND_CREATE, ENTITY_NONE) == NULL) {
+		return ENTITY_NONE;
+	}
+	return (ECS_PENDING_GENERATION << ECS_INDEX_BITS) | buffer->numCreated++;
+}
+
+void commandDestroyEntity(CommandBuffer* buffer, EntityID id) {
+	pushCommand(buffer, ECS_COMMAND_DESTROY, id);
+}
+
+void commandAddComponent(CommandBuffer* buffer, EntityID id, ComponentType type, const void* value) {
+	size_t size = getComponentSize(type);
+
+	if (buffer->dataSize + size > buffer->dataCapacity) {
+		size_t capacity = buffer->dataCapacity ? buffer->dataCapacity * 2 : 4096;
+		while (capacity < buffer->dataSize + size) {
+			capacity *= 2;
+		}
+		unsigned char* data = realloc(buffer->data, capacity);
+		if (data == NULL) {
+			printf("Error: Out of memory recording component %d for entity %u\n", type, id);
+			return;
+		}
+		buffer->data = data;
+		buffer->dataCapacity = capacity;
+	}
+
+	EcsCommand* command = pushCommand(buffer, ECS_COMMAND_ADD, id);
+	if (command == NULL) {
+		return;
+	}
+
+	command->component = type;
+	command->dataOffset = buffer->dataSize;
+	if (value != NULL) {
+		memcpy(buffer->data + buffer->dataSize, value, size);
+	}
+	else {
+		memset(buffer->data + buffer->dataSize, 0, size);
+	}
+	buffer->dataSize += size;
+}
+
+void commandRemoveComponent(CommandBuffer* buffer, EntityID id, ComponentType type) {
+	EcsCommand* command = pushCommand(buffer, ECS_COMMAND_REMOVE, id);
+	if (command != NULL) {
+		command->component = type;
+	}
+}
+
+void applyCommands(ECS* ecs, CommandBuffer* buffer) {
+	if (buffer->numCreated > buffer->createdCapacity) {
+		EntityID* created = realloc(buffer->created, buffer->numCreated * sizeof(EntityID));
+		if (created == NULL) {
+			printf("Error: Out of memory applying %u ECS commands\n", buffer->numCommands);
+			return;
+		}
+		buffer->created = created;
+		buffer->createdCapacity = buffer->numCreated;
+	}
+
+	unsigned int next_created = 0;
+	for (unsigned int i = 0; i < buffer->numCommands; ++i) {
+		const EcsCommand* command = &buffer->commands[i];
+		EntityID id = command->entity;
+
+		if (ENTITY_IS_PENDING(id)) {
+			id = ENTITY_INDEX(id) < next_created ? buffer->created[ENTITY_INDEX(id)] : ENTITY_NONE;
+		}
+
+		if (command->type == ECS_COMMAND_CREATE) {
+			buffer->created[next_created++] = createEntity(ecs);
+			continue;
+		}
+
+		if (!isEntityAlive(ecs, id)) {
+			continue;
+		}
+
+		switch (command->type) {
+		case ECS_COMMAND_DESTROY:
+			destroyEntity(ecs, id);
+			break;
+		case ECS_COMMAND_ADD: {
+			void* component = addComponent(ecs, id, command->component);
+			if (component != NULL) {
+				memcpy(component, buffer->data + command->dataOffset, getComponentSize(command->component));
+				markComponentChanged(ecs, id, command->component);
+			}
+			break;
+		}
+		case ECS_COMMAND_REMOVE:
+			removeComponent(ecs, id, command->component);
+			break;
+		default:
+			break;
+		}
+	}
+
+	buffer->numCommands = 0;
+	buffer->dataSize = 0;
+	buffer->numCreated = 0;
+}
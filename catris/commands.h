@@ -0,0 +1,50 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "ecs.h"
+
+// Structural changes recorded while iterating and applied later in one pass, in recording order.
+// Nothing in the ECS moves until applyCommands, so queries and component pointers stay valid.
+// Commands on entities that are gone by the time they're applied are dropped, so two systems
+// destroying the same entity is fine.
+
+typedef enum {
+	ECS_COMMAND_CREATE,
+	ECS_COMMAND_DESTROY,
+	ECS_COMMAND_ADD,
+	ECS_COMMAND_REMOVE
+} EcsCommandType;
+
+typedef struct {
+	EcsCommandType type;
+	ComponentType component;
+	EntityID entity;
+	size_t dataOffset; // ECS_COMMAND_ADD: where the component value starts in data
+} EcsCommand;
+
+typedef struct {
+	EcsCommand *commands;
+	unsigned int numCommands;
+	unsigned int commandCapacity;
+	unsigned char *data; // component values for ECS_COMMAND_ADD
+	size_t dataSize;
+	size_t dataCapacity;
+	EntityID *created; // pending index -> created entity, filled while applying
+	unsigned int numCreated;
+	unsigned int createdCapacity;
+} CommandBuffer;
+
+void initCommandBuffer(CommandBuffer* buffer);
+void freeCommandBuffer(CommandBuffer* buffer);
+
+// Returns a pending handle, usable in later commands of the same buffer until it's applied
+EntityID commandCreateEntity(CommandBuffer* buffer);
+void commandDestroyEntity(CommandBuffer* buffer, EntityID id);
+// Copies value, NULL adds a zeroed component. An existing component is overwritten.
+void commandAddComponent(CommandBuffer* buffer, EntityID id, ComponentType type, const void* value);
+void commandRemoveComponent(CommandBuffer* buffer, EntityID id, ComponentType type);
+
+// Applies and clears the buffer, call it where nothing is iterating the ECS
+void applyCommands(ECS* ecs, CommandBuffer* buffer);
+
+#endif
@@ -11,5 +11,7 @@
 #define Y_MIN (SCREEN_HEIGHT /2)
 #define Y_MAX -(SCREEN_HEIGHT /2)
 #define TILE_SIZE 64.0f
+#define GHOST_PIECE_ALPHA 0.3f
+#define QUICKSAVE_PATH "quicksave.snapshot"
 
 #endif
\ No newline at end of file
@@ -1,25 +1,1238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "ecs.h"
 
-void initECS(ECS* ecs) {
-	ecs->numAvailable = MAX_ENTITIES;
-	for (unsigned int i = 0; i < MAX_ENTITIES; ++i) {
-		ecs->availableIDs[i] = MAX_ENTITIES - i - 1;
-		ecs->entities[i].id = MAX_ENTITIES; // Invalid ID to indicate unused entity slot
-		ecs->entities[i].componentMask = COMPONENT_NONE;
+static const size_t componentSizes[COMPONENT_TYPE_COUNT] = {
+	sizeof(ModelComponent),
+	sizeof(VelocityComponent),
+	sizeof(TileComponent),
+	sizeof(CameraComponent),
+	sizeof(VertexComponent),
+	sizeof(TextureComponent),
+	sizeof(TransformComponent),
+	sizeof(HierarchyComponent),
+	sizeof(SpriteComponent),
+	sizeof(BlockComponent),
+};
+
+static size_t alignSize(size_t size) {
+	return (size + 15) & ~(size_t)15;
+}
+
+static bool typeInMask(ComponentMask mask, int type) {
+	return (mask >> type) & 1u;
+}
+
+// Grows a table of page pointers by one entry, the pages themselves never move
+static bool growPageTable(void*** table, unsigned int num_pages) {
+	void** pages = realloc(*table, (num_pages + 1) * sizeof(void*));
+	if (pages == NULL) {
+		return 0;
+	}
+	pages[num_pages] = NULL;
+	*table = pages;
+	return 1;
+}
+
+// Entities
+
+static Entity* entityAt(const ECS* ecs, unsigned int index) {
+	return &ecs->entityPages[index / ECS_ENTITY_PAGE_SIZE][index % ECS_ENTITY_PAGE_SIZE];
+}
+
+// The slot of a live handle, NULL if the handle is stale or was never valid
+static Entity* resolveEntity(const ECS* ecs, EntityID id) {
+	unsigned int index = ENTITY_INDEX(id);
+
+	if (id == ENTITY_NONE || index >= ecs->numSlots) {
+		return NULL;
+	}
+
+	Entity* entity = entityAt(ecs, index);
+	return entity->id == id ? entity : NULL;
+}
+
+// Sparse storage
+
+static void* poolComponent(const ComponentPool* pool, unsigned int index) {
+	return (char*)pool->dataPages[index / ECS_POOL_PAGE_SIZE] + (size_t)(index % ECS_POOL_PAGE_SIZE) * pool->componentSize;
+}
+
+static EntityID* poolEntity(const ComponentPool* pool, unsigned int index) {
+	return &pool->densePages[index / ECS_POOL_PAGE_SIZE][index % ECS_POOL_PAGE_SIZE];
+}
+
+static unsigned int* poolTick(const ComponentPool* pool, unsigned int index) {
+	return &pool->tickPages[index / ECS_POOL_PAGE_SIZE][index % ECS_POOL_PAGE_SIZE];
+}
+
+// Sparse page tables map an entity index to a packed index, ECS_INVALID_INDEX if there is none
+static unsigned int sparsePagesGet(unsigned int** pages, unsigned int num_pages, unsigned int entity_index) {
+	unsigned int page = entity_index / ECS_ENTITY_PAGE_SIZE;
+
+	if (page >= num_pages || pages[page] == NULL) {
+		return ECS_INVALID_INDEX;
+	}
+	return pages[page][entity_index % ECS_ENTITY_PAGE_SIZE];
+}
+
+// Pages are allocated the first time an entity in their range is mapped
+static unsigned int* sparsePagesSlot(unsigned int*** pages, unsigned int* num_pages, unsigned int entity_index) {
+	unsigned int page = entity_index / ECS_ENTITY_PAGE_SIZE;
+
+	while (page >= *num_pages) {
+		if (!growPageTable((void***)pages, *num_pages)) {
+			return NULL;
+		}
+		(*num_pages)++;
+	}
+
+	if ((*pages)[page] == NULL) {
+		unsigned int* slots = malloc(ECS_ENTITY_PAGE_SIZE * sizeof(unsigned int));
+		if (slots == NULL) {
+			return NULL;
+		}
+		for (unsigned int i = 0; i < ECS_ENTITY_PAGE_SIZE; ++i) {
+			slots[i] = ECS_INVALID_INDEX;
+		}
+		(*pages)[page] = slots;
+	}
+
+	return &(*pages)[page][entity_index % ECS_ENTITY_PAGE_SIZE];
+}
+
+// Packed index of an entity's component, ECS_INVALID_INDEX if it has none
+static unsigned int sparseIndex(const ComponentPool* pool, unsigned int entity_index) {
+	return sparsePagesGet(pool->sparsePages, pool->numSparsePages, entity_index);
+}
+
+static unsigned int* sparseSlot(ComponentPool* pool, unsigned int entity_index) {
+	return sparsePagesSlot(&pool->sparsePages, &pool->numSparsePages, entity_index);
+}
+
+static bool growPool(ComponentPool* pool) {
+	if (!growPageTable((void***)&pool->densePages, pool->numPages) || !growPageTable(&pool->dataPages, pool->numPages)
+		|| !growPageTable((void***)&pool->tickPages, pool->numPages)) {
+		return 0;
+	}
+
+	pool->densePages[pool->numPages] = malloc(ECS_POOL_PAGE_SIZE * sizeof(EntityID));
+	pool->dataPages[pool->numPages] = malloc(ECS_POOL_PAGE_SIZE * pool->componentSize);
+	pool->tickPages[pool->numPages] = malloc(ECS_POOL_PAGE_SIZE * sizeof(unsigned int));
+	if (pool->densePages[pool->numPages] == NULL || pool->dataPages[pool->numPages] == NULL || pool->tickPages[pool->numPages] == NULL) {
+		free(pool->densePages[pool->numPages]);
+		free(pool->dataPages[pool->numPages]);
+		free(pool->tickPages[pool->numPages]);
+		pool->densePages[pool->numPages] = NULL;
+		pool->dataPages[pool->numPages] = NULL;
+		pool->tickPages[pool->numPages] = NULL;
+		return 0;
+	}
+
+	pool->numPages++;
+	return 1;
+}
+
+static void* sparseAdd(ECS* ecs, EntityID id, ComponentType type) {
+	ComponentPool* pool = &ecs->pools[type];
+	unsigned int* slot = sparseSlot(pool, ENTITY_INDEX(id));
+
+	if (slot == NULL || (pool->count == pool->numPages * ECS_POOL_PAGE_SIZE && !growPool(pool))) {
+		return NULL;
+	}
+
+	unsigned int index = pool->count++;
+	*slot = index;
+	*poolEntity(pool, index) = id;
+	*poolTick(pool, index) = ecs->changeTick;
+
+	void* component = poolComponent(pool, index);
+	memset(component, 0, pool->componentSize);
+	return component;
+}
+
+static void sparseRemove(ECS* ecs, EntityID id, ComponentType type) {
+	ComponentPool* pool = &ecs->pools[type];
+	unsigned int* slot = sparseSlot(pool, ENTITY_INDEX(id));
+	unsigned int index = *slot;
+
+	// Swap the last component into the hole to keep the pool packed
+	unsigned int last = --pool->count;
+	if (index != last) {
+		EntityID moved = *poolEntity(pool, last);
+		memcpy(poolComponent(pool, index), poolComponent(pool, last), pool->componentSize);
+		*poolEntity(pool, index) = moved;
+		*poolTick(pool, index) = *poolTick(pool, last);
+		*sparseSlot(pool, ENTITY_INDEX(moved)) = index;
+	}
+
+	*slot = ECS_INVALID_INDEX;
+}
+
+static bool maskMatches(ComponentMask mask, ComponentMask required, ComponentMask excluded) {
+	return (mask & required) == required && (mask & excluded) == 0;
+}
+
+// Cached queries
+
+static void cachedQueryAddArchetype(CachedQuery* query, unsigned int archetype) {
+	if (query->numArchetypes == query->archetypeCapacity) {
+		unsigned int capacity = query->archetypeCapacity ? query->archetypeCapacity * 2 : 8;
+		unsigned int* archetypes = realloc(query->archetypes, capacity * sizeof(unsigned int));
+		if (archetypes == NULL) {
+			printf("Error: Out of memory updating a cached query\n");
+			query->dirty = 1;
+			return;
+		}
+		query->archetypes = archetypes;
+		query->archetypeCapacity = capacity;
+	}
+	query->archetypes[query->numArchetypes++] = archetype;
+}
+
+// An entity is listed when its position is valid. Running out of memory leaves it unlisted and the
+// query dirty.
+static void cachedQueryAddEntity(CachedQuery* query, EntityID id) {
+	unsigned int* position = sparsePagesSlot(&query->positionPages, &query->numPositionPages, ENTITY_INDEX(id));
+
+	if (position == NULL) {
+		printf("Error: Out of memory updating a cached query\n");
+		query->dirty = 1;
+		return;
+	}
+	if (*position != ECS_INVALID_INDEX) {
+		return;
+	}
+
+	if (query->numEntities == query->entityCapacity) {
+		unsigned int capacity = query->entityCapacity ? query->entityCapacity * 2 : 64;
+		EntityID* entities = realloc(query->entities, capacity * sizeof(EntityID));
+		if (entities == NULL) {
+			printf("Error: Out of memory updating a cached query\n");
+			query->dirty = 1;
+			return;
+		}
+		query->entities = entities;
+		query->entityCapacity = capacity;
+	}
+	*position = query->numEntities;
+	query->entities[query->numEntities++] = id;
+}
+
+static void cachedQueryRemoveEntity(CachedQuery* query, EntityID id) {
+	unsigned int* position = sparsePagesSlot(&query->positionPages, &query->numPositionPages, ENTITY_INDEX(id));
+
+	if (position == NULL || *position == ECS_INVALID_INDEX) {
+		return;
+	}
+
+	unsigned int index = *position;
+
+	// Swap the last entity into the hole, the list order doesn't matter
+	EntityID moved = query->entities[--query->numEntities];
+	if (index != query->numEntities) {
+		query->entities[index] = moved;
+		*sparsePagesSlot(&query->positionPages, &query->numPositionPages, ENTITY_INDEX(moved)) = index;
+	}
+	*position = ECS_INVALID_INDEX;
+}
+
+// Fills the query again from scratch, with the archetypes or entities matching now
+static void rebuildCachedQuery(ECS* ecs, CachedQuery* query) {
+	query->dirty = 0;
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		query->numArchetypes = 0;
+		for (unsigned int i = 0; i < ecs->numArchetypes; ++i) {
+			if (maskMatches(ecs->archetypes[i].mask, query->required, query->excluded)) {
+				cachedQueryAddArchetype(query, i);
+			}
+		}
+		return;
+	}
+
+	for (unsigned int i = 0; i < query->numEntities; ++i) {
+		*sparsePagesSlot(&query->positionPages, &query->numPositionPages, ENTITY_INDEX(query->entities[i])) = ECS_INVALID_INDEX;
+	}
+	query->numEntities = 0;
+
+	for (unsigned int i = 0; i < ecs->numSlots; ++i) {
+		const Entity* entity = entityAt(ecs, i);
+		if (entity->id != ENTITY_NONE && maskMatches(entity->componentMask, query->required, query->excluded)) {
+			cachedQueryAddEntity(query, entity->id);
+		}
+	}
+}
+
+// Sparse mode: moves an entity in or out of the queries its mask change affects. Dirty queries are
+// rebuilt first, from the masks before this change.
+static void updateCachedQueries(ECS* ecs, EntityID id, ComponentMask old_mask, ComponentMask new_mask) {
+	for (unsigned int i = 0; i < ecs->numQueries; ++i) {
+		CachedQuery* query = &ecs->queries[i];
+
+		if (query->dirty) {
+			rebuildCachedQuery(ecs, query);
+		}
+
+		bool matched = maskMatches(old_mask, query->required, query->excluded);
+		bool matches = maskMatches(new_mask, query->required, query->excluded);
+
+		if (matches && !matched) {
+			cachedQueryAddEntity(query, id);
+		}
+		else if (matched && !matches) {
+			cachedQueryRemoveEntity(query, id);
+		}
+	}
+}
+
+// Archetype storage
+
+static void* chunkComponent(ArchetypeChunk* chunk, int type, unsigned int row) {
+	return (char*)chunk->columns[type] + (size_t)row * componentSizes[type];
+}
+
+// Copies a component and its change tick from one chunk row to another
+static void chunkCopy(ArchetypeChunk* dst, unsigned int dst_row, ArchetypeChunk* src, unsigned int src_row, int type) {
+	unsigned int tick = src->ticks[type][src_row];
+
+	memcpy(chunkComponent(dst, type, dst_row), chunkComponent(src, type, src_row), componentSizes[type]);
+	dst->ticks[type][dst_row] = tick;
+	if (tick > dst->changedTick[type]) {
+		dst->changedTick[type] = tick;
+	}
+}
+
+static ArchetypeChunk* createChunk(ComponentMask mask) {
+	size_t offsets[COMPONENT_TYPE_COUNT];
+	size_t tick_offsets[COMPONENT_TYPE_COUNT];
+	size_t size = alignSize(sizeof(ArchetypeChunk));
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		if (typeInMask(mask, type)) {
+			offsets[type] = size;
+			size += alignSize(componentSizes[type] * ECS_CHUNK_CAPACITY);
+			tick_offsets[type] = size;
+			size += alignSize(sizeof(unsigned int) * ECS_CHUNK_CAPACITY);
+		}
+	}
+
+	// Header and columns in one allocation
+	char* memory = malloc(size);
+	if (memory == NULL) {
+		return NULL;
+	}
+
+	ArchetypeChunk* chunk = (ArchetypeChunk*)memory;
+	chunk->count = 0;
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		chunk->columns[type] = typeInMask(mask, type) ? memory + offsets[type] : NULL;
+		chunk->ticks[type] = typeInMask(mask, type) ? (unsigned int*)(memory + tick_offsets[type]) : NULL;
+		chunk->changedTick[type] = 0;
+	}
+	return chunk;
+}
+
+static unsigned int findArchetype(ECS* ecs, ComponentMask mask) {
+	for (unsigned int i = 0; i < ecs->numArchetypes; ++i) {
+		if (ecs->archetypes[i].mask == mask) {
+			return i;
+		}
+	}
+
+	if (ecs->numArchetypes == ecs->archetypeCapacity) {
+		unsigned int capacity = ecs->archetypeCapacity ? ecs->archetypeCapacity * 2 : 8;
+		Archetype* archetypes = realloc(ecs->archetypes, capacity * sizeof(Archetype));
+		if (archetypes == NULL) {
+			return ECS_INVALID_INDEX;
+		}
+		ecs->archetypes = archetypes;
+		ecs->archetypeCapacity = capacity;
+	}
+
+	Archetype* archetype = &ecs->archetypes[ecs->numArchetypes];
+	archetype->mask = mask;
+	archetype->chunks = NULL;
+	archetype->numChunks = 0;
+	archetype->chunkCapacity = 0;
+
+	// Archetypes are never removed, so cached queries only ever gain them
+	for (unsigned int i = 0; i < ecs->numQueries; ++i) {
+		if (ecs->queries[i].dirty) {
+			rebuildCachedQuery(ecs, &ecs->queries[i]);
+		}
+		if (maskMatches(mask, ecs->queries[i].required, ecs->queries[i].excluded)) {
+			cachedQueryAddArchetype(&ecs->queries[i], ecs->numArchetypes);
+		}
+	}
+	return ecs->numArchetypes++;
+}
+
+// Reserves a row at the end of the archetype, the components are left uninitialized
+static bool archetypeInsert(ECS* ecs, unsigned int index, EntityID id, EntityLocation* location) {
+	Archetype* archetype = &ecs->archetypes[index];
+
+	if (archetype->numChunks == 0 || archetype->chunks[archetype->numChunks - 1]->count == ECS_CHUNK_CAPACITY) {
+		if (archetype->numChunks == archetype->chunkCapacity) {
+			ArchetypeChunk** chunks = realloc(archetype->chunks, (archetype->chunkCapacity + 1) * sizeof(ArchetypeChunk*));
+			if (chunks == NULL) {
+				return 0;
+			}
+			archetype->chunks = chunks;
+
+			ArchetypeChunk* chunk = createChunk(archetype->mask);
+			if (chunk == NULL) {
+				return 0;
+			}
+			archetype->chunks[archetype->chunkCapacity++] = chunk;
+		}
+		archetype->numChunks++;
+	}
+
+	ArchetypeChunk* chunk = archetype->chunks[archetype->numChunks - 1];
+	location->archetype = index;
+	location->chunk = archetype->numChunks - 1;
+	location->row = chunk->count;
+	chunk->entities[chunk->count++] = id;
+	return 1;
+}
+
+static void archetypeRemove(ECS* ecs, EntityLocation location) {
+	Archetype* archetype = &ecs->archetypes[location.archetype];
+	ArchetypeChunk* chunk = archetype->chunks[location.chunk];
+	ArchetypeChunk* last_chunk = archetype->chunks[archetype->numChunks - 1];
+	unsigned int last_row = last_chunk->count - 1;
+
+	// Fill the hole with the archetype's last entity so only the last chunk is partly full
+	if (chunk != last_chunk || location.row != last_row) {
+		EntityID moved = last_chunk->entities[last_row];
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if (typeInMask(archetype->mask, type)) {
+				chunkCopy(chunk, location.row, last_chunk, last_row, type);
+			}
+		}
+		chunk->entities[location.row] = moved;
+		entityAt(ecs, ENTITY_INDEX(moved))->location = location;
+	}
+
+	if (--last_chunk->count == 0) {
+		archetype->numChunks--;
+	}
+}
+
+// Moves an entity to the archetype of its new mask, keeping the components both masks share
+static bool archetypeMove(ECS* ecs, Entity* entity, ComponentMask new_mask) {
+	EntityLocation old_location = entity->location;
+	EntityLocation new_location = { ECS_INVALID_INDEX, 0, 0 };
+	ComponentMask old_mask = entity->componentMask;
+
+	if (new_mask != COMPONENT_NONE) {
+		unsigned int index = findArchetype(ecs, new_mask);
+		if (index == ECS_INVALID_INDEX || !archetypeInsert(ecs, index, entity->id, &new_location)) {
+			return 0;
+		}
+
+		ArchetypeChunk* chunk = ecs->archetypes[index].chunks[new_location.chunk];
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if (!typeInMask(new_mask, type)) {
+				continue;
+			}
+
+			if (typeInMask(old_mask, type)) {
+				ArchetypeChunk* old_chunk = ecs->archetypes[old_location.archetype].chunks[old_location.chunk];
+				chunkCopy(chunk, new_location.row, old_chunk, old_location.row, type);
+			}
+			else {
+				memset(chunkComponent(chunk, type, new_location.row), 0, componentSizes[type]);
+				chunk->ticks[type][new_location.row] = ecs->changeTick;
+				chunk->changedTick[type] = ecs->changeTick;
+			}
+		}
+	}
+
+	if (old_location.archetype != ECS_INVALID_INDEX) {
+		archetypeRemove(ecs, old_location);
+	}
+
+	entity->location = new_location;
+	entity->componentMask = new_mask;
+	return 1;
+}
+
+void initECS(ECS* ecs, EcsStorage storage) {
+	ecs->storage = storage;
+	ecs->entityPages = NULL;
+	ecs->numEntityPages = 0;
+	ecs->numSlots = 0;
+	ecs->numAlive = 0;
+	ecs->freeHead = ECS_INVALID_INDEX;
+	ecs->freeTail = ECS_INVALID_INDEX;
+	ecs->changeTick = 1;
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		ComponentPool* pool = &ecs->pools[type];
+		pool->componentSize = componentSizes[type];
+		pool->sparsePages = NULL;
+		pool->numSparsePages = 0;
+		pool->densePages = NULL;
+		pool->dataPages = NULL;
+		pool->tickPages = NULL;
+		pool->numPages = 0;
+		pool->count = 0;
+	}
+
+	ecs->archetypes = NULL;
+	ecs->numArchetypes = 0;
+	ecs->archetypeCapacity = 0;
+
+	ecs->queries = NULL;
+	ecs->numQueries = 0;
+	ecs->queryCapacity = 0;
+}
+
+// Frees the entities and components but keeps the registered queries, emptied
+static void clearECS(ECS* ecs) {
+	CachedQuery* queries = ecs->queries;
+	unsigned int num_queries = ecs->numQueries;
+	unsigned int query_capacity = ecs->queryCapacity;
+
+	ecs->queries = NULL;
+	ecs->numQueries = 0;
+	freeECS(ecs);
+
+	ecs->queries = queries;
+	ecs->numQueries = num_queries;
+	ecs->queryCapacity = query_capacity;
+	for (unsigned int i = 0; i < num_queries; ++i) {
+		// Listed entities are unlisted, their positions outlive the entities
+		for (unsigned int j = 0; j < queries[i].numEntities; ++j) {
+			*sparsePagesSlot(&queries[i].positionPages, &queries[i].numPositionPages, ENTITY_INDEX(queries[i].entities[j])) = ECS_INVALID_INDEX;
+		}
+		queries[i].numArchetypes = 0;
+		queries[i].numEntities = 0;
+		queries[i].dirty = 0;
+	}
+}
+
+void freeECS(ECS* ecs) {
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		ComponentPool* pool = &ecs->pools[type];
+		for (unsigned int i = 0; i < pool->numSparsePages; ++i) {
+			free(pool->sparsePages[i]);
+		}
+		for (unsigned int i = 0; i < pool->numPages; ++i) {
+			free(pool->densePages[i]);
+			free(pool->dataPages[i]);
+			free(pool->tickPages[i]);
+		}
+		free(pool->sparsePages);
+		free(pool->densePages);
+		free(pool->dataPages);
+		free(pool->tickPages);
+	}
+
+	for (unsigned int i = 0; i < ecs->numArchetypes; ++i) {
+		for (unsigned int c = 0; c < ecs->archetypes[i].chunkCapacity; ++c) {
+			free(ecs->archetypes[i].chunks[c]);
+		}
+		free(ecs->archetypes[i].chunks);
 	}
+	free(ecs->archetypes);
+
+	for (unsigned int i = 0; i < ecs->numEntityPages; ++i) {
+		free(ecs->entityPages[i]);
+	}
+	free(ecs->entityPages);
+
+	for (unsigned int i = 0; i < ecs->numQueries; ++i) {
+		CachedQuery* query = &ecs->queries[i];
+		for (unsigned int p = 0; p < query->numPositionPages; ++p) {
+			free(query->positionPages[p]);
+		}
+		free(query->positionPages);
+		free(query->archetypes);
+		free(query->entities);
+	}
+	free(ecs->queries);
+
+	initECS(ecs, ecs->storage);
 }
 
 EntityID createEntity(ECS* ecs) {
-	if (ecs->numAvailable > 0) {
-		EntityID id = ecs->availableIDs[--ecs->numAvailable];
-		ecs->entities[id].id = id;
-		ecs->entities[id].componentMask = COMPONENT_NONE;
-		return id;
+	unsigned int index;
+	Entity* entity;
+
+	if (ecs->freeHead != ECS_INVALID_INDEX) {
+		index = ecs->freeHead;
+		entity = entityAt(ecs, index);
+		ecs->freeHead = entity->nextFree;
+		if (ecs->freeHead == ECS_INVALID_INDEX) {
+			ecs->freeTail = ECS_INVALID_INDEX;
+		}
 	}
-	return MAX_ENTITIES; // No available ID
+	else {
+		if (ecs->numSlots == ECS_MAX_ENTITIES) {
+			return ENTITY_NONE;
+		}
+
+		if (ecs->numSlots == ecs->numEntityPages * ECS_ENTITY_PAGE_SIZE) {
+			if (!growPageTable((void***)&ecs->entityPages, ecs->numEntityPages)) {
+				return ENTITY_NONE;
+			}
+			ecs->entityPages[ecs->numEntityPages] = malloc(ECS_ENTITY_PAGE_SIZE * sizeof(Entity));
+			if (ecs->entityPages[ecs->numEntityPages] == NULL) {
+				return ENTITY_NONE;
+			}
+			ecs->numEntityPages++;
+		}
+
+		index = ecs->numSlots++;
+		entity = entityAt(ecs, index);
+		entity->generation = 0;
+	}
+
+	entity->id = (entity->generation << ECS_INDEX_BITS) | index;
+	entity->componentMask = COMPONENT_NONE;
+	entity->nextFree = ECS_INVALID_INDEX;
+	entity->location.archetype = ECS_INVALID_INDEX;
+	ecs->numAlive++;
+	return entity->id;
 }
 
 void destroyEntity(ECS* ecs, EntityID id) {
-	ecs->entities[id].componentMask = COMPONENT_NONE;
-	ecs->availableIDs[ecs->numAvailable++] = id;
-}
\ No newline at end of file
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL) {
+		printf("Error: destroyEntity called with stale entity %u\n", id);
+		return;
+	}
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		if (entity->location.archetype != ECS_INVALID_INDEX) {
+			archetypeRemove(ecs, entity->location);
+			entity->location.archetype = ECS_INVALID_INDEX;
+		}
+	}
+	else {
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if (typeInMask(entity->componentMask, type)) {
+				sparseRemove(ecs, id, (ComponentType)type);
+			}
+		}
+		updateCachedQueries(ecs, id, entity->componentMask, COMPONENT_NONE);
+	}
+
+	unsigned int index = ENTITY_INDEX(id);
+	entity->id = ENTITY_NONE;
+	entity->componentMask = COMPONENT_NONE;
+	entity->generation = (entity->generation + 1) % ECS_PENDING_GENERATION;
+
+	if (ecs->freeTail != ECS_INVALID_INDEX) {
+		entityAt(ecs, ecs->freeTail)->nextFree = index;
+	}
+	else {
+		ecs->freeHead = index;
+	}
+	ecs->freeTail = index;
+	ecs->numAlive--;
+}
+
+bool isEntityAlive(const ECS* ecs, EntityID id) {
+	return resolveEntity(ecs, id) != NULL;
+}
+
+void* addComponent(ECS* ecs, EntityID id, ComponentType type) {
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL) {
+		printf("Error: addComponent called with stale entity %u\n", id);
+		return NULL;
+	}
+
+	if (typeInMask(entity->componentMask, type)) {
+		return getComponent(ecs, id, type);
+	}
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		if (!archetypeMove(ecs, entity, entity->componentMask | (1u << type))) {
+			printf("Error: Out of memory adding component %d to entity %u\n", type, id);
+			return NULL;
+		}
+		return getComponent(ecs, id, type);
+	}
+
+	void* component = sparseAdd(ecs, id, type);
+	if (component == NULL) {
+		printf("Error: Out of memory adding component %d to entity %u\n", type, id);
+		return NULL;
+	}
+	updateCachedQueries(ecs, id, entity->componentMask, entity->componentMask | (1u << type));
+	entity->componentMask |= 1u << type;
+	return component;
+}
+
+bool addComponents(ECS* ecs, EntityID id, ComponentMask mask) {
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL) {
+		printf("Error: addComponents called with stale entity %u\n", id);
+		return 0;
+	}
+
+	ComponentMask new_mask = entity->componentMask | mask;
+	if (new_mask == entity->componentMask) {
+		return 1;
+	}
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		if (!archetypeMove(ecs, entity, new_mask)) {
+			printf("Error: Out of memory adding components %u to entity %u\n", mask, id);
+			return 0;
+		}
+		return 1;
+	}
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		if (typeInMask(mask, type) && addComponent(ecs, id, (ComponentType)type) == NULL) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// The entity must have the component
+static void* entityComponent(const ECS* ecs, const Entity* entity, int type) {
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		EntityLocation location = entity->location;
+		return chunkComponent(ecs->archetypes[location.archetype].chunks[location.chunk], type, location.row);
+	}
+
+	const ComponentPool* pool = &ecs->pools[type];
+	return poolComponent(pool, sparseIndex(pool, ENTITY_INDEX(entity->id)));
+}
+
+void* getComponent(ECS* ecs, EntityID id, ComponentType type) {
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL || !typeInMask(entity->componentMask, type)) {
+		return NULL;
+	}
+	return entityComponent(ecs, entity, type);
+}
+
+void removeComponent(ECS* ecs, EntityID id, ComponentType type) {
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL || !typeInMask(entity->componentMask, type)) {
+		return;
+	}
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		if (!archetypeMove(ecs, entity, entity->componentMask & ~(1u << type))) {
+			printf("Error: Out of memory removing component %d from entity %u\n", type, id);
+		}
+		return;
+	}
+
+	sparseRemove(ecs, id, type);
+	updateCachedQueries(ecs, id, entity->componentMask, entity->componentMask & ~(1u << type));
+	entity->componentMask &= ~(1u << type);
+}
+
+bool hasComponents(const ECS* ecs, EntityID id, ComponentMask mask) {
+	const Entity* entity = resolveEntity(ecs, id);
+	return entity != NULL && (entity->componentMask & mask) == mask;
+}
+
+size_t getComponentSize(ComponentType type) {
+	return componentSizes[type];
+}
+
+unsigned int advanceChangeTick(ECS* ecs) {
+	return ++ecs->changeTick;
+}
+
+void markComponentChanged(ECS* ecs, EntityID id, ComponentType type) {
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL || !typeInMask(entity->componentMask, type)) {
+		return;
+	}
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		ArchetypeChunk* chunk = ecs->archetypes[entity->location.archetype].chunks[entity->location.chunk];
+		chunk->ticks[type][entity->location.row] = ecs->changeTick;
+		chunk->changedTick[type] = ecs->changeTick;
+		return;
+	}
+
+	ComponentPool* pool = &ecs->pools[type];
+	*poolTick(pool, sparseIndex(pool, ENTITY_INDEX(id))) = ecs->changeTick;
+}
+
+unsigned int getComponentTick(const ECS* ecs, EntityID id, ComponentType type) {
+	Entity* entity = resolveEntity(ecs, id);
+
+	if (entity == NULL || !typeInMask(entity->componentMask, type)) {
+		return 0;
+	}
+
+	if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		return ecs->archetypes[entity->location.archetype].chunks[entity->location.chunk]->ticks[type][entity->location.row];
+	}
+
+	const ComponentPool* pool = &ecs->pools[type];
+	return *poolTick(pool, sparseIndex(pool, ENTITY_INDEX(id)));
+}
+
+// Snapshots
+
+#define ECS_SNAPSHOT_MAGIC 0x53455443 // "CTES"
+#define ECS_SNAPSHOT_VERSION 3
+
+// Followed by numSlots EcsSnapshotSlots, then a block per component type holding the components of
+// every live entity that has it, in slot order. Blocks start 16 byte aligned.
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numTypes; // COMPONENT_TYPE_COUNT, sizes the arrays below
+	uint32_t numSlots;
+	uint32_t freeHead;
+	uint32_t freeTail;
+	uint32_t changeTick;
+	uint32_t componentSizes[COMPONENT_TYPE_COUNT];
+	uint32_t componentCounts[COMPONENT_TYPE_COUNT];
+} EcsSnapshotHeader;
+
+typedef struct {
+	uint32_t id;
+	uint32_t componentMask;
+	uint32_t generation;
+	uint32_t nextFree;
+} EcsSnapshotSlot;
+
+static unsigned int countComponents(const ECS* ecs, int type) {
+	unsigned int count = 0;
+
+	if (ecs->storage == ECS_STORAGE_SPARSE) {
+		return ecs->pools[type].count;
+	}
+
+	for (unsigned int i = 0; i < ecs->numArchetypes; ++i) {
+		const Archetype* archetype = &ecs->archetypes[i];
+		if (typeInMask(archetype->mask, type) && archetype->numChunks > 0) {
+			count += (archetype->numChunks - 1) * ECS_CHUNK_CAPACITY + archetype->chunks[archetype->numChunks - 1]->count;
+		}
+	}
+	return count;
+}
+
+static size_t snapshotSize(unsigned int num_slots, const uint32_t counts[COMPONENT_TYPE_COUNT]) {
+	size_t size = alignSize(sizeof(EcsSnapshotHeader) + (size_t)num_slots * sizeof(EcsSnapshotSlot));
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		size += alignSize((size_t)counts[type] * componentSizes[type]);
+	}
+	return size;
+}
+
+// GPU handles are only meaningful in the context that made them
+static void clearGpuHandles(int type, void* component) {
+	if (type == COMPONENT_TYPE_TEXTURE) {
+		((TextureComponent*)component)->textureId = 0;
+	}
+}
+
+size_t getECSSnapshotSize(const ECS* ecs) {
+	uint32_t counts[COMPONENT_TYPE_COUNT];
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		counts[type] = countComponents(ecs, type);
+	}
+	return snapshotSize(ecs->numSlots, counts);
+}
+
+void writeECSSnapshot(const ECS* ecs, void* out) {
+	EcsSnapshotHeader* header = out;
+	EcsSnapshotSlot* slots = (EcsSnapshotSlot*)(header + 1);
+	char* blocks[COMPONENT_TYPE_COUNT];
+
+	memset(header, 0, sizeof(EcsSnapshotHeader));
+	header->magic = ECS_SNAPSHOT_MAGIC;
+	header->version = ECS_SNAPSHOT_VERSION;
+	header->numTypes = COMPONENT_TYPE_COUNT;
+	header->numSlots = ecs->numSlots;
+	header->freeHead = ecs->freeHead;
+	header->freeTail = ecs->freeTail;
+	header->changeTick = ecs->changeTick;
+
+	char* block = (char*)out + alignSize(sizeof(EcsSnapshotHeader) + (size_t)ecs->numSlots * sizeof(EcsSnapshotSlot));
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		header->componentSizes[type] = (uint32_t)componentSizes[type];
+		header->componentCounts[type] = countComponents(ecs, type);
+		blocks[type] = block;
+		block += alignSize((size_t)header->componentCounts[type] * componentSizes[type]);
+	}
+
+	for (unsigned int i = 0; i < ecs->numSlots; ++i) {
+		const Entity* entity = entityAt(ecs, i);
+		slots[i].id = entity->id;
+		slots[i].componentMask = entity->componentMask;
+		slots[i].generation = entity->generation;
+		slots[i].nextFree = entity->nextFree;
+
+		if (entity->id == ENTITY_NONE) {
+			continue;
+		}
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if (typeInMask(entity->componentMask, type)) {
+				memcpy(blocks[type], entityComponent(ecs, entity, type), componentSizes[type]);
+				clearGpuHandles(type, blocks[type]);
+				blocks[type] += componentSizes[type];
+			}
+		}
+	}
+}
+
+static bool snapshotIndexValid(uint32_t index, uint32_t num_slots) {
+	return index == ECS_INVALID_INDEX || index < num_slots;
+}
+
+static bool ecsSnapshotIsValid(const void* data, size_t size) {
+	const EcsSnapshotHeader* header = data;
+	uint32_t counts[COMPONENT_TYPE_COUNT] = { 0 };
+
+	if (size < sizeof(EcsSnapshotHeader) || header->magic != ECS_SNAPSHOT_MAGIC || header->version != ECS_SNAPSHOT_VERSION
+		|| header->numTypes != COMPONENT_TYPE_COUNT
+		|| header->numSlots > ECS_MAX_ENTITIES || !snapshotIndexValid(header->freeHead, header->numSlots)
+		|| !snapshotIndexValid(header->freeTail, header->numSlots)) {
+		return 0;
+	}
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		if (header->componentSizes[type] != componentSizes[type] || header->componentCounts[type] > ECS_MAX_ENTITIES) {
+			return 0;
+		}
+	}
+
+	if (size < snapshotSize(header->numSlots, header->componentCounts)) {
+		return 0;
+	}
+
+	// The blocks have to hold exactly the components the masks promise
+	const EcsSnapshotSlot* slots = (const EcsSnapshotSlot*)(header + 1);
+	for (uint32_t i = 0; i < header->numSlots; ++i) {
+		if (!snapshotIndexValid(slots[i].nextFree, header->numSlots) || slots[i].generation >= ECS_PENDING_GENERATION) {
+			return 0;
+		}
+		if (slots[i].id == ENTITY_NONE) {
+			continue;
+		}
+		if (ENTITY_INDEX(slots[i].id) != i || ENTITY_GENERATION(slots[i].id) != slots[i].generation
+			|| (slots[i].componentMask >> COMPONENT_TYPE_COUNT) != 0) {
+			return 0;
+		}
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			counts[type] += typeInMask(slots[i].componentMask, type);
+		}
+	}
+
+	return memcmp(counts, header->componentCounts, sizeof(counts)) == 0;
+}
+
+static bool reserveEntitySlots(ECS* ecs, unsigned int num_slots) {
+	while (ecs->numEntityPages * ECS_ENTITY_PAGE_SIZE < num_slots) {
+		if (!growPageTable((void***)&ecs->entityPages, ecs->numEntityPages)) {
+			return 0;
+		}
+		ecs->entityPages[ecs->numEntityPages] = malloc(ECS_ENTITY_PAGE_SIZE * sizeof(Entity));
+		if (ecs->entityPages[ecs->numEntityPages] == NULL) {
+			return 0;
+		}
+		ecs->numEntityPages++;
+	}
+	return 1;
+}
+
+bool readECSSnapshot(ECS* ecs, const void* data, size_t size) {
+	const EcsSnapshotHeader* header = data;
+	const EcsSnapshotSlot* slots = (const EcsSnapshotSlot*)(header + 1);
+	const char* blocks[COMPONENT_TYPE_COUNT];
+
+	if (!ecsSnapshotIsValid(data, size)) {
+		printf("Error: Not a snapshot of this ECS\n");
+		return 0;
+	}
+
+	// Readers compare against ticks they saw before the restore, so keep counting up from the newer
+	unsigned int tick = (ecs->changeTick > header->changeTick ? ecs->changeTick : header->changeTick) + 1;
+
+	clearECS(ecs);
+	ecs->changeTick = tick;
+	if (!reserveEntitySlots(ecs, header->numSlots)) {
+		printf("Error: Out of memory restoring an ECS snapshot\n");
+		clearECS(ecs);
+		return 0;
+	}
+	ecs->numSlots = header->numSlots;
+	ecs->freeHead = header->freeHead;
+	ecs->freeTail = header->freeTail;
+
+	const char* block = (const char*)data + alignSize(sizeof(EcsSnapshotHeader) + (size_t)header->numSlots * sizeof(EcsSnapshotSlot));
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		blocks[type] = block;
+		block += alignSize((size_t)header->componentCounts[type] * componentSizes[type]);
+	}
+
+	for (unsigned int i = 0; i < header->numSlots; ++i) {
+		Entity* entity = entityAt(ecs, i);
+		ComponentMask mask = slots[i].componentMask;
+
+		entity->id = slots[i].id;
+		entity->componentMask = COMPONENT_NONE;
+		entity->generation = slots[i].generation;
+		entity->nextFree = slots[i].nextFree;
+		entity->location.archetype = ECS_INVALID_INDEX;
+
+		if (entity->id == ENTITY_NONE) {
+			continue;
+		}
+		ecs->numAlive++;
+
+		// Straight into the final archetype or pools, the components are zeroed and stamped with tick
+		bool added = 1;
+		if (ecs->storage == ECS_STORAGE_ARCHETYPE) {
+			added = mask == COMPONENT_NONE || archetypeMove(ecs, entity, mask);
+		}
+		else {
+			for (int type = 0; type < COMPONENT_TYPE_COUNT && added; ++type) {
+				if (typeInMask(mask, type)) {
+					added = sparseAdd(ecs, entity->id, (ComponentType)type) != NULL;
+					if (added) {
+						entity->componentMask |= 1u << type;
+					}
+				}
+			}
+			updateCachedQueries(ecs, entity->id, COMPONENT_NONE, entity->componentMask);
+		}
+		if (!added) {
+			printf("Error: Out of memory restoring an ECS snapshot\n");
+			clearECS(ecs);
+			return 0;
+		}
+
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if (typeInMask(mask, type)) {
+				memcpy(entityComponent(ecs, entity, type), blocks[type], componentSizes[type]);
+				blocks[type] += componentSizes[type];
+			}
+		}
+	}
+
+	return 1;
+}
+
+QueryID registerQuery(ECS* ecs, ComponentMask required, ComponentMask excluded) {
+	if (required == COMPONENT_NONE) {
+		printf("Error: A cached query needs at least one required component\n");
+		return ECS_INVALID_INDEX;
+	}
+
+	for (unsigned int i = 0; i < ecs->numQueries; ++i) {
+		if (ecs->queries[i].required == required && ecs->queries[i].excluded == excluded) {
+			return i;
+		}
+	}
+
+	if (ecs->numQueries == ecs->queryCapacity) {
+		unsigned int capacity = ecs->queryCapacity ? ecs->queryCapacity * 2 : 8;
+		CachedQuery* queries = realloc(ecs->queries, capacity * sizeof(CachedQuery));
+		if (queries == NULL) {
+			printf("Error: Out of memory registering a query\n");
+			return ECS_INVALID_INDEX;
+		}
+		ecs->queries = queries;
+		ecs->queryCapacity = capacity;
+	}
+
+	CachedQuery* query = &ecs->queries[ecs->numQueries];
+	memset(query, 0, sizeof(CachedQuery));
+	query->required = required;
+	query->excluded = excluded;
+
+	// Fill it once, from here on the ECS keeps it up to date
+	rebuildCachedQuery(ecs, query);
+
+	return ecs->numQueries++;
+}
+
+void queryBegin(QueryIterator* it, ECS* ecs, ComponentMask required, ComponentMask excluded) {
+	it->ecs = ecs;
+	it->required = required;
+	it->excluded = excluded;
+	it->changed = COMPONENT_NONE;
+	it->sinceTick = 0;
+	it->count = 0;
+	it->entities = NULL;
+	it->archetype = 0;
+	it->chunk = 0;
+	it->index = 0;
+	it->driver = -1;
+	it->query = ECS_INVALID_INDEX;
+
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		it->columns[type] = NULL;
+	}
+
+	// Sparse mode walks the smallest required pool and checks the rest of the mask
+	if (ecs->storage == ECS_STORAGE_SPARSE) {
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if (typeInMask(required, type) && (it->driver < 0 || ecs->pools[type].count < ecs->pools[it->driver].count)) {
+				it->driver = type;
+			}
+		}
+	}
+}
+
+void queryBeginChanged(QueryIterator* it, ECS* ecs, ComponentMask required, ComponentMask excluded, ComponentMask changed, unsigned int since_tick) {
+	queryBegin(it, ecs, required | changed, excluded);
+	it->changed = changed;
+	it->sinceTick = since_tick;
+}
+
+void queryBeginCached(QueryIterator* it, ECS* ecs, QueryID query) {
+	queryBegin(it, ecs, ecs->queries[query].required, ecs->queries[query].excluded);
+	// A dirty query is missing entities, testing every mask still finds them
+	if (!ecs->queries[query].dirty) {
+		it->query = query;
+	}
+}
+
+void queryBeginCachedChanged(QueryIterator* it, ECS* ecs, QueryID query, ComponentMask changed, unsigned int since_tick) {
+	queryBeginCached(it, ecs, query);
+	it->changed = changed & ecs->queries[query].required;
+	it->sinceTick = since_tick;
+}
+
+// Chunk ticks only ever grow, so a chunk whose newest tick is old has nothing to visit
+static bool chunkChangedSince(const ArchetypeChunk* chunk, ComponentMask changed, unsigned int since_tick) {
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		if (typeInMask(changed, type) && chunk->changedTick[type] > since_tick) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static bool rowChangedSince(const ArchetypeChunk* chunk, unsigned int row, ComponentMask changed, unsigned int since_tick) {
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+		if (typeInMask(changed, type) && chunk->ticks[type][row] > since_tick) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static bool queryNextArchetype(QueryIterator* it) {
+	ECS* ecs = it->ecs;
+	const CachedQuery* query = it->query != ECS_INVALID_INDEX ? &ecs->queries[it->query] : NULL;
+	unsigned int num_archetypes = query != NULL ? query->numArchetypes : ecs->numArchetypes;
+
+	// A cached query walks its own list of matching archetypes
+	for (; it->archetype < num_archetypes; ++it->archetype, it->chunk = 0, it->index = 0) {
+		Archetype* archetype = &ecs->archetypes[query != NULL ? query->archetypes[it->archetype] : it->archetype];
+
+		if (query == NULL && !maskMatches(archetype->mask, it->required, it->excluded)) {
+			continue;
+		}
+
+		for (; it->chunk < archetype->numChunks; ++it->chunk, it->index = 0) {
+			ArchetypeChunk* chunk = archetype->chunks[it->chunk];
+			unsigned int start = it->index;
+			unsigned int end = chunk->count;
+
+			// Narrow the span to the next run of changed rows
+			if (it->changed != COMPONENT_NONE) {
+				if (!chunkChangedSince(chunk, it->changed, it->sinceTick)) {
+					continue;
+				}
+				while (start < end && !rowChangedSince(chunk, start, it->changed, it->sinceTick)) {
+					start++;
+				}
+				end = start;
+				while (end < chunk->count && rowChangedSince(chunk, end, it->changed, it->sinceTick)) {
+					end++;
+				}
+			}
+
+			if (start == end) {
+				continue;
+			}
+
+			it->index = end;
+			it->count = end - start;
+			it->entities = chunk->entities + start;
+			for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+				it->columns[type] = typeInMask(it->required, type) ? chunkComponent(chunk, type, start) : NULL;
+			}
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static bool queryNextSparse(QueryIterator* it) {
+	ECS* ecs = it->ecs;
+	const CachedQuery* query = it->query != ECS_INVALID_INDEX ? &ecs->queries[it->query] : NULL;
+	ComponentPool* pool = it->driver >= 0 ? &ecs->pools[it->driver] : NULL;
+	unsigned int end = query != NULL ? query->numEntities : pool != NULL ? pool->count : ecs->numSlots;
+
+	while (it->index < end) {
+		unsigned int index = it->index++;
+		Entity* entity;
+
+		// A cached query's entities are known to match
+		if (query != NULL) {
+			entity = entityAt(ecs, ENTITY_INDEX(query->entities[index]));
+		}
+		else {
+			entity = entityAt(ecs, pool != NULL ? ENTITY_INDEX(*poolEntity(pool, index)) : index);
+			if (entity->id == ENTITY_NONE || !maskMatches(entity->componentMask, it->required, it->excluded)) {
+				continue;
+			}
+		}
+
+		if (it->changed != COMPONENT_NONE) {
+			bool changed = 0;
+			for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+				ComponentPool* changed_pool = &ecs->pools[type];
+				if (typeInMask(it->changed, type) && *poolTick(changed_pool, sparseIndex(changed_pool, ENTITY_INDEX(entity->id))) > it->sinceTick) {
+					changed = 1;
+				}
+			}
+			if (!changed) {
+				continue;
+			}
+		}
+
+		it->count = 1;
+		it->entities = &entity->id;
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			ComponentPool* column = &ecs->pools[type];
+			it->columns[type] = typeInMask(it->required, type) ? poolComponent(column, sparseIndex(column, ENTITY_INDEX(entity->id))) : NULL;
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+bool queryNext(QueryIterator* it) {
+	if (it->ecs->storage == ECS_STORAGE_ARCHETYPE) {
+		return queryNextArchetype(it);
+	}
+	return queryNextSparse(it);
+}
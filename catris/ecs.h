@@ -1,20 +1,36 @@
 #ifndef ECS_H
 #define ECS_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <cglm/struct.h>
 
-#define MAX_ENTITIES 1000
+// An EntityID is a handle: the slot index in the low bits and the slot's generation in the
+// high bits. Destroying an entity bumps the generation so stale handles stop resolving.
+#define ECS_INDEX_BITS 20
+#define ECS_INDEX_MASK ((1u << ECS_INDEX_BITS) - 1)
+#define ECS_GENERATION_MASK (0xFFFFFFFFu >> ECS_INDEX_BITS)
+#define ECS_MAX_ENTITIES ECS_INDEX_MASK // the last index is reserved for ENTITY_NONE
+#define ENTITY_NONE 0xFFFFFFFFu
+#define ENTITY_INDEX(id) ((id) & ECS_INDEX_MASK)
+#define ENTITY_GENERATION(id) ((id) >> ECS_INDEX_BITS)
+// Live entities never get the last generation, handles with it are placeholders for entities
+// a CommandBuffer is going to create (see commands.h)
+#define ECS_PENDING_GENERATION ECS_GENERATION_MASK
+#define ENTITY_IS_PENDING(id) ((id) != ENTITY_NONE && ENTITY_GENERATION(id) == ECS_PENDING_GENERATION)
+
+// Storage grows a page at a time, pages never move once allocated
+#define ECS_ENTITY_PAGE_SIZE 1024
+#define ECS_POOL_PAGE_SIZE 256
+
+typedef unsigned int EntityID;
+typedef unsigned int ComponentMask;
 
 typedef struct {
 	float dx, dy;
 } VelocityComponent;
 
-typedef struct {
-	unsigned int VAO;
-	unsigned int VBO;
-	unsigned int VEO;
-} OpenglComponent;
-
 typedef struct {
 	float x;
 	float y;
@@ -38,46 +54,245 @@ typedef struct {
 	unsigned int indices[6];
 } VertexComponent;
 
+#define TEXTURE_PATH_SIZE 64
+
+// The path is stored inline so the component can be copied and saved as plain bytes
 typedef struct {
-	char* path;
+	char path[TEXTURE_PATH_SIZE];
 	unsigned int textureId;
 } TextureComponent;
 
-typedef unsigned int EntityID;
-typedef unsigned int ComponentMask;
+// Links an entity into a tree of transforms, its TransformComponent is then relative to the parent
+// and its ModelComponent is the parent's model times its own. See setTransformParent in transform.h.
+typedef struct {
+	EntityID parent; // ENTITY_NONE for a root
+	EntityID firstChild;
+	EntityID nextSibling;
+} HierarchyComponent;
+
+// Sprites are drawn a layer at a time, lowest first, fully transparent ones are skipped
+typedef struct {
+	float alpha;
+	unsigned int layer;
+} SpriteComponent;
+
+// A cell of a tetromino on the board, state is one of the game's BlockStates
+typedef struct {
+	unsigned int state;
+} BlockComponent;
+
+// Compact 2D transform, the ModelComponent matrix is composed from it (see transform.h)
+typedef struct {
+	float x;
+	float y;
+	float rotation; // radians, counter clockwise
+	float scaleX;
+	float scaleY;
+} TransformComponent;
+
+// Component types, a type's bit in a ComponentMask is 1 << type
+typedef enum {
+	COMPONENT_TYPE_MODEL,
+	COMPONENT_TYPE_VELOCITY,
+	COMPONENT_TYPE_TILE,
+	COMPONENT_TYPE_CAMERA,
+	COMPONENT_TYPE_VERTEX,
+	COMPONENT_TYPE_TEXTURE,
+	COMPONENT_TYPE_TRANSFORM,
+	COMPONENT_TYPE_HIERARCHY,
+	COMPONENT_TYPE_SPRITE,
+	COMPONENT_TYPE_BLOCK,
+	COMPONENT_TYPE_COUNT
+} ComponentType;
 
 // Component bitmasks
 #define COMPONENT_NONE     0
 #define COMPONENT_MODEL    1  // binary: 0001
 #define COMPONENT_VELOCITY 2  // binary: 0010
-#define COMPONENT_OPENGL   4  // binary: 0100
-#define COMPONENT_TILE     8  // binary: 1000
-#define COMPONENT_CAMERA   16 // binary: 0001 0000
-#define COMPONENT_VERTEX   32 // binary: 0010 0000
-#define COMPONENT_TEXTURE  64 // binary: 0100 0000
+#define COMPONENT_TILE     4  // binary: 0100
+#define COMPONENT_CAMERA   8  // binary: 1000
+#define COMPONENT_VERTEX   16 // binary: 0001 0000
+#define COMPONENT_TEXTURE  32 // binary: 0010 0000
+#define COMPONENT_TRANSFORM 64  // binary: 0100 0000
+#define COMPONENT_HIERARCHY 128 // binary: 1000 0000
+#define COMPONENT_SPRITE    256 // binary: 0001 0000 0000
+#define COMPONENT_BLOCK     512 // binary: 0010 0000 0000
+
+#define ECS_INVALID_INDEX 0xFFFFFFFFu
+
+// Sparse mode: each component type lives in its own pool, cheap to add and remove components.
+// Archetype mode: entities with the same mask share a table of SoA chunks, fast to iterate.
+typedef enum {
+	ECS_STORAGE_SPARSE,
+	ECS_STORAGE_ARCHETYPE
+} EcsStorage;
+
+typedef struct {
+	unsigned int archetype; // ECS_INVALID_INDEX while the entity has no components
+	unsigned int chunk;
+	unsigned int row;
+} EntityLocation;
 
 typedef struct {
-	EntityID id;
+	EntityID id; // current handle, ENTITY_NONE while the slot is free
 	ComponentMask componentMask;
+	unsigned int generation;
+	unsigned int nextFree;
+	EntityLocation location; // archetype mode only
 } Entity;
 
+// Sparse set storage for one component type. Components are packed, with the owning entity and the
+// change tick at the same index in the dense ids and ticks, and the sparse pages map an entity index
+// to that packed index (ECS_INVALID_INDEX if absent). All are paged, see poolComponent() in ecs.c.
+typedef struct {
+	size_t componentSize;
+	unsigned int **sparsePages;
+	unsigned int numSparsePages;
+	EntityID **densePages;
+	void **dataPages;
+	unsigned int **tickPages;
+	unsigned int numPages;
+	unsigned int count;
+} ComponentPool;
+
+#define ECS_CHUNK_CAPACITY 128
+
+// Up to ECS_CHUNK_CAPACITY entities of one archetype, one packed column per component type
+typedef struct {
+	EntityID entities[ECS_CHUNK_CAPACITY];
+	void *columns[COMPONENT_TYPE_COUNT]; // NULL for types outside the archetype
+	unsigned int *ticks[COMPONENT_TYPE_COUNT]; // change tick of every component in the columns
+	unsigned int changedTick[COMPONENT_TYPE_COUNT]; // newest tick in each ticks column, lets queries skip the chunk
+	unsigned int count;
+} ArchetypeChunk;
+
+// Every chunk but the last is full, removing an entity moves the archetype's last entity into its row
+typedef struct {
+	ComponentMask mask;
+	ArchetypeChunk **chunks;
+	unsigned int numChunks; // chunks in use
+	unsigned int chunkCapacity; // chunks allocated, unused ones are kept for reuse
+} Archetype;
+
+// A query registered with registerQuery. The ECS keeps its matches up to date as entities change,
+// the matching archetypes in archetype mode and the matching entities in sparse mode, so iterating
+// it never tests masks.
 typedef struct {
-	Entity entities[MAX_ENTITIES];
-	ModelComponent modelComponent[MAX_ENTITIES];
-	VelocityComponent velocityComponents[MAX_ENTITIES];
-	OpenglComponent openglComponents[MAX_ENTITIES];
-	TileComponent tileComponents[MAX_ENTITIES];
-	CameraComponent cameraComponents[MAX_ENTITIES];
-	VertexComponent vertexComponents[MAX_ENTITIES];
-	TextureComponent textureComponents[MAX_ENTITIES];
-	unsigned int availableIDs[MAX_ENTITIES];
-	unsigned int numAvailable;
+	ComponentMask required;
+	ComponentMask excluded;
+	unsigned int *archetypes;
+	unsigned int numArchetypes;
+	unsigned int archetypeCapacity;
+	EntityID *entities;
+	unsigned int numEntities;
+	unsigned int entityCapacity;
+	unsigned int **positionPages; // entity index to its position in entities, paged like a pool's sparse pages
+	unsigned int numPositionPages;
+	bool dirty; // an update ran out of memory, iterated uncached until the next update rebuilds it
+} CachedQuery;
+
+typedef unsigned int QueryID;
+
+typedef struct {
+	EcsStorage storage;
+	Entity **entityPages;
+	unsigned int numEntityPages;
+	unsigned int numSlots; // slots ever handed out
+	unsigned int numAlive;
+	// Freed slots are reused oldest first so a generation takes long to come around again
+	unsigned int freeHead;
+	unsigned int freeTail;
+	unsigned int changeTick;
+	ComponentPool pools[COMPONENT_TYPE_COUNT];
+	Archetype *archetypes;
+	unsigned int numArchetypes;
+	unsigned int archetypeCapacity;
+	CachedQuery *queries;
+	unsigned int numQueries;
+	unsigned int queryCapacity;
 } ECS;
 
-void initECS(ECS* ecs);
+void initECS(ECS* ecs, EcsStorage storage);
+void freeECS(ECS* ecs);
 
+// ENTITY_NONE when ECS_MAX_ENTITIES are alive or memory runs out
 EntityID createEntity(ECS* ecs);
 
 void destroyEntity(ECS* ecs, EntityID id);
+bool isEntityAlive(const ECS* ecs, EntityID id);
+
+// Adds a zeroed component, or returns the existing one.
+// In archetype mode this moves the entity to another table, earlier component pointers become invalid.
+void* addComponent(ECS* ecs, EntityID id, ComponentType type);
+// Adds zeroed components for every type in mask the entity doesn't have yet, in archetype mode with a
+// single move. false when the handle is stale or memory runs out.
+bool addComponents(ECS* ecs, EntityID id, ComponentMask mask);
+// NULL when the entity doesn't have the component or the handle is stale
+void* getComponent(ECS* ecs, EntityID id, ComponentType type);
+void removeComponent(ECS* ecs, EntityID id, ComponentType type);
+bool hasComponents(const ECS* ecs, EntityID id, ComponentMask mask);
+size_t getComponentSize(ComponentType type);
+
+// Change tracking. Every component remembers the tick it last changed at, adding it counts as a change.
+// Writes through component pointers aren't seen, call markComponentChanged after modifying one.
+// The tick starts at 1 and is advanced once per frame, right after runSystems, so a system that
+// remembers the tick it ran at sees everything written after it on the next frame.
+unsigned int advanceChangeTick(ECS* ecs);
+void markComponentChanged(ECS* ecs, EntityID id, ComponentType type);
+// 0 when the entity doesn't have the component
+unsigned int getComponentTick(const ECS* ecs, EntityID id, ComponentType type);
+
+// Snapshots. writeECSSnapshot copies every entity slot and live component into one flat image of
+// getECSSnapshotSize bytes, readECSSnapshot replaces the contents of an ECS with such an image.
+// Handles stay valid across a round trip and the image doesn't depend on the storage mode.
+// OpenGL components and texture ids are saved zeroed and have to be made again after a restore.
+// Restored components are stamped with a tick newer than any before, so every one counts as changed.
+size_t getECSSnapshotSize(const ECS* ecs);
+void writeECSSnapshot(const ECS* ecs, void* out);
+// false if data isn't an image of this build's components, ecs is then left as it was.
+// Running out of memory part way leaves it empty.
+bool readECSSnapshot(ECS* ecs, const void* data, size_t size);
+
+// Visits every entity that has all required and none of the excluded components, a span at a time.
+// A span is count entities with their components in columns[type] for each required type,
+// a whole chunk in archetype mode and a single entity in sparse mode. Don't add or remove
+// components while iterating.
+// queryBeginChanged only visits entities where one of the changed components has a tick newer than
+// since_tick, the changed types are required too. Archetype spans are then runs of changed rows.
+//
+//	QueryIterator it;
+//	queryBegin(&it, ecs, COMPONENT_MODEL | COMPONENT_SPRITE, COMPONENT_NONE);
+//	while (queryNext(&it)) {
+//		ModelComponent *models = it.columns[COMPONENT_TYPE_MODEL];
+//		for (unsigned int i = 0; i < it.count; i++) { ... models[i] ... it.entities[i] ... }
+//	}
+typedef struct {
+	ECS *ecs;
+	ComponentMask required;
+	ComponentMask excluded;
+	ComponentMask changed;
+	unsigned int sinceTick;
+	unsigned int count;
+	EntityID *entities;
+	void *columns[COMPONENT_TYPE_COUNT];
+	// Cursor
+	unsigned int archetype;
+	unsigned int chunk;
+	unsigned int index; // archetype mode: next row in the chunk, sparse mode: next candidate
+	int driver; // sparse mode: pool walked to find candidates, -1 walks all entity slots
+	QueryID query; // ECS_INVALID_INDEX unless started from a cached query
+} QueryIterator;
+
+void queryBegin(QueryIterator* it, ECS* ecs, ComponentMask required, ComponentMask excluded);
+void queryBeginChanged(QueryIterator* it, ECS* ecs, ComponentMask required, ComponentMask excluded, ComponentMask changed, unsigned int since_tick);
+bool queryNext(QueryIterator* it);
+
+// Cached queries for the ones systems run every frame. Registering the same masks again returns the
+// same query, queries live until freeECS and survive readECSSnapshot. ECS_INVALID_INDEX when required
+// is COMPONENT_NONE or memory runs out.
+QueryID registerQuery(ECS* ecs, ComponentMask required, ComponentMask excluded);
+void queryBeginCached(QueryIterator* it, ECS* ecs, QueryID query);
+// Only changed types that are part of the query's required mask are checked
+void queryBeginCachedChanged(QueryIterator* it, ECS* ecs, QueryID query, ComponentMask changed, unsigned int since_tick);
 
 #endif
\ No newline at end of file
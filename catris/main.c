@@ -17,6 +17,13 @@
 #include "opengl.h"
 #include "scene.h"
 #include "hash.h"
+#include "board.h"
+#include "sim.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "transform.h"
+#include "prefab.h"
+#include "sprite_batch.h"
 
 
 void processInput(GLFWwindow *window);
@@ -24,23 +31,23 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void checkCompileErrors(unsigned int shader, const char* type);
 void calculate_uv_coords(int texture_atlas_width, int texture_atlas_height, int tile_x, int tile_y, int tile_width, int tile_height, float* uv_coords);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
-
-typedef enum {
-	TETROMINO_I,
-	TETROMINO_O,
-	TETROMINO_T,
-	TETROMINO_J,
-	TETROMINO_L,
-	TETROMINO_S,
-	TETROMINO_Z
-} TetrominoShape;
+void build_sprite_quad(ApplicationContext *context, char* texture, float tile_x, float tile_y, float tile_width, float tile_height, VertexComponent *vertex);
 
 typedef enum {
 	DO_NOT_RENDER,
 	BLOCK_DESCENDING,
-	BLOCK_COLLIDED
+	BLOCK_COLLIDED,
+	BLOCK_CLEARED // faded out with its row, destroy_cleared_blocks_system removes it
 } BlockStates;
 
+// SpriteComponent layers, drawn in this order
+typedef enum {
+	SPRITE_LAYER_BACKGROUND,
+	SPRITE_LAYER_BLOCKS,
+	SPRITE_LAYER_GHOST,
+	SPRITE_LAYER_COUNT
+} SpriteLayers;
+
 typedef enum {
 	IDLE,
 	PLAYER_FINISHED_MOVE,
@@ -53,34 +60,6 @@ typedef enum {
 
 } SystemActions;
 
-typedef struct RenderComponent {
-	unsigned int VAO;
-	unsigned int VBO;
-	unsigned int VEO;
-	float tile_x;
-	float tile_y;
-} RenderComponent;
-
-typedef struct SingleBlock {
-	mat4 model;
-	vec2 velocity;
-	float alpha;
-	BlockStates currentState;
-	RenderComponent renderComponent;
-} SingleBlock;
-
-typedef struct BG {
-	mat4 model;
-	RenderComponent renderComponent;
-} BG;
-
-typedef struct {
-	SingleBlock *array;
-	size_t size;
-	size_t capacity;
-} DynamicArray;
-
-
 typedef struct GameState GameState;
 
 typedef struct {
@@ -90,8 +69,8 @@ typedef struct {
 	float stepValue;
 } AnimationProperty;
 
-typedef void(*AnimationStepCallback)(GameState* gameState, SingleBlock **animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties);
-typedef void(*AnimationCompleteCallback)(GameState* gameState, SingleBlock **animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties);
+typedef void(*AnimationStepCallback)(GameState* gameState, EntityID *animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties);
+typedef void(*AnimationCompleteCallback)(GameState* gameState, EntityID *animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties);
 
 typedef enum {
 	ANIM_LINEAR,
@@ -106,7 +85,8 @@ typedef struct {
 	size_t numProperties;
 	AnimationStepCallback stepCallback;
 	AnimationCompleteCallback completeCallback;
-	SingleBlock* animation_objects[GRID_SURFFACE];
+	EntityID animation_objects[GRID_SURFFACE]; // block entities
+	float animation_object_scales[GRID_SURFFACE]; // per object multiplier of the animated properties
 	size_t num_animation_objects;
 	AnimationType type;
 } Animation;
@@ -138,15 +118,33 @@ typedef enum {
 
 typedef struct GameState {
 	//Scene *currentScene;
-	BG bg;
-	TetrominoShape current_shape;
-	int num_blocks;
-	mat4 projection;
-	unsigned int SHADER_PROGRAM;
+	ApplicationContext *context;
 	SystemActions action_queue;
-	unsigned int grid[GRID_ROWS][GRID_COLS];
-	DynamicArray blocks;
+	SimState sim;
+	// Every input given to the sim, saved when the window closes
+	ReplayRecorder replay;
+	double replayStartTime;
+	bool recordReplay; // cleared by loading a save state, the game no longer follows from its seed
+	// F5/F9, handled between frames while nothing holds pointers into the ECS
+	bool saveRequested;
+	bool loadRequested;
+	// Rows cleared by the last lock, removed and dropped in one animation
+	int clearedRows[PIECE_CELLS];
+	int numClearedRows;
 	Animations animations;
+	// Every block is a sprite entity with a BlockComponent, locked ones are found through blockQuery.
+	// Blocks are stamped from a prefab per shape for the head cell and one for the others.
+	ECS *ecs;
+	QueryID blockQuery; // BLOCK | TRANSFORM
+	Prefab blockPrefabs[TETROMINO_COUNT * 2];
+	// The falling piece as one parent transform at the centre of its box with a block per cell as
+	// its children, moving or rotating the piece only touches the parent. The cells are ENTITY_NONE
+	// from the lock until the next spawn.
+	EntityID activePiece;
+	EntityID activePieceCells[PIECE_CELLS];
+	// Copies the active cells' quads and textures and sits where a hard drop would put them, see sync_ghost_piece
+	EntityID ghostPiece;
+	EntityID ghostPieceCells[PIECE_CELLS];
 } GameState;
 
 //void levelInit(Scene *self) {
@@ -255,120 +253,6 @@ void updateAnimation(Animation* animation, GameState* gameState, double currentT
 	}
 }
 
-void initDynamicArray(DynamicArray *da, size_t initialCapacity) {
-	da->array = (SingleBlock *)malloc(initialCapacity * sizeof(SingleBlock));
-	da->size = 0;
-	da->capacity = initialCapacity;
-}
-
-void addSingleBlock(DynamicArray *da, SingleBlock block) {
-	if (da->size == da->capacity) {
-		da->capacity *= 2;
-		da->array = (SingleBlock *)realloc(da->array, da->capacity * sizeof(SingleBlock));
-	}
-	da->array[da->size++] = block;
-}
-
-void freeDynamicArray(DynamicArray *da) {
-	free(da->array);
-	da->array = NULL;
-	da->size = da->capacity = 0;
-}
-
-void printBlocks(DynamicArray *blocks) {
-	printf("+------+---------+---------+\n");
-	printf("|  ID  |    X    |    Y    |\n");
-	printf("+------+---------+---------+\n");
-
-	for (unsigned int i = 0; i < blocks->size; i++) {
-		float x = blocks->array[i].model[3][0];
-		float y = blocks->array[i].model[3][1];
-
-		printf("| %d | %7.2f | %7.2f |\n", i, x, y);
-	}
-
-	printf("+------+---------+---------+\n");
-
-}
-void removeSingleBlock(DynamicArray *da, float x_value, float y_value) {
-	bool found = 0;
-	x_value = roundf(x_value);
-	y_value = roundf(y_value);
-
-	for (size_t i = 0; i < da->size; i++) {
-		if (roundf(da->array[i].model[3][0]) == x_value && roundf(da->array[i].model[3][1]) == y_value) {
-			printf("deleting %d \n", i);
-			found = 1;
-			glDeleteVertexArrays(1, &da->array[i].renderComponent.VAO);
-			glDeleteBuffers(1, &da->array[i].renderComponent.VBO);
-			glDeleteBuffers(1, &da->array[i].renderComponent.VEO);
-
-			// Move the last element to the current position
-			da->array[i] = da->array[da->size - 1];
-			da->size--;
-			break; // Assuming only one block is to be removed
-		}
-	}
-
-	if (found == 0) {
-		printBlocks(da);
-		printf("NOTHING WAS FOUND");
-	}
-}
-
-void copySingleBlock(SingleBlock* dest, const SingleBlock* src) {
-	memcpy(dest->model, src->model, sizeof(mat4)); // Copy mat4
-	memcpy(&(dest->velocity), &(src->velocity), sizeof(vec2)); // Copy vec2
-	dest->currentState = src->currentState;
-
-	// Direct copy of RenderComponent as it contains simple data types
-	dest->renderComponent = src->renderComponent;
-}
-
-float get_block_absolute_x(mat4 model) {
-	return roundf(model[3][0] - 32.0f);
-}
-
-float get_block_absolute_y(mat4 model) {
-	return roundf(model[3][1] + 32.0f);
-}
-
-
-
-
-
-unsigned int opengl_init_shaders() {
-	unsigned int ID;
-	unsigned int vertex, fragment;
-	char* vertexShaderSource = readShaderSource("shaders/vertex_shader.glsl");
-	char* fragmentShaderSource = readShaderSource("shaders/fragment_shader.glsl");
-
-	// vertex shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
-
-	// fragment Shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fragmentShaderSource, NULL);
-	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
-
-	// shader Program
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
-
-	// delete the shaders as they're linked into our program now and no longer necessary
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
-
-	return ID;
-}
-
 GLFWwindow* opengl_create_window(GameState *gameState) {
 	GLFWwindow* window;
 
@@ -404,66 +288,9 @@ GLFWwindow* opengl_create_window(GameState *gameState) {
 	return window;
 }
 
-void opengl_translate_block(mat4 model, GameState *gameState) {
-	glUseProgram(gameState->SHADER_PROGRAM);
-	GLint model_uniform_location = glGetUniformLocation(gameState->SHADER_PROGRAM, "model");
-	GLint projection_uniform_location = glGetUniformLocation(gameState->SHADER_PROGRAM, "projection");
-
-	glUniformMatrix4fv(projection_uniform_location, 1, GL_FALSE, (float *)gameState->projection);
-	glUniformMatrix4fv(model_uniform_location, 1, GL_FALSE, (float *)model);
-}
-
-
-void opengl_init_block(SingleBlock *block, GameState *gameState) {
-	float uv_coords[8];
-	int texture_atlas_width = 640;
-	int texture_atlas_height = 640;
-	int tile_width = 64;
-	int tile_height = 64;
-
-	calculate_uv_coords(
-		texture_atlas_width, texture_atlas_height,
-		block->renderComponent.tile_x, block->renderComponent.tile_y, tile_width, tile_height, uv_coords);
-
-	float vertices[] = {
-		// positions          // colors           // texture coords
-		0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, uv_coords[0], uv_coords[1],   // top right
-		0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, uv_coords[2], uv_coords[3],   // bottom right
-		-0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, uv_coords[4], uv_coords[5],   // bottom left
-		-0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f, uv_coords[6], uv_coords[7]    // top left 
-	};
-
-	unsigned int indices[] = {
-		0, 1, 3, // first triangle
-		1, 2, 3  // second triangle
-	};
-
-	glm_mat4_identity(block->model);
-	vec3 size = { 64, 64, 1.0f };
-	glm_scale(block->model, size);
-
-	setupShaderAndUniforms(gameState->SHADER_PROGRAM, gameState->projection, block->model, 0.0f);
-	setupVertexData(&block->renderComponent.VAO, &block->renderComponent.VBO, &block->renderComponent.VEO, vertices, sizeof(vertices), indices, sizeof(indices));
-}
-
-void initializeGrid(unsigned int grid[GRID_ROWS][GRID_COLS]) {
-	for (int row = 0; row < GRID_ROWS; ++row) {
-		for (int col = 0; col < GRID_COLS; ++col) {
-			if (col < 3 || col > 12) {
-				grid[row][col] = 1;
-			}
-			else {
-				grid[row][col] = 0;
-			}
-
-
-		}
-	}
-}
-
-void initializeAnimObjectsPointerArray(SingleBlock* buffer[GRID_SURFFACE]) {
+void initializeAnimObjectsArray(EntityID buffer[GRID_SURFFACE]) {
 	for (int x = 0; x < GRID_SURFFACE; x++) {
-		buffer[x] = NULL;
+		buffer[x] = ENTITY_NONE;
 	}
 }
 
@@ -480,23 +307,6 @@ void findGridPosition(float x, float y, int *row, int *col) {
 	*row = (y - Y_MIN) / cellHeight;
 }
 
-void setGridValue(unsigned int grid[GRID_ROWS][GRID_COLS], float x, float y, unsigned int value) {
-	int row, col;
-	x = roundf(x);
-	y = roundf(y);
-
-	findGridPosition(x, y, &row, &col);
-
-	// Check if the calculated position is within the grid bounds
-	if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
-		grid[row][col] = value;
-	}
-	else {
-		printf("Error: Position (x: %d, y: %d) is out of grid bounds\n", x, y);
-	}
-}
-
-
 void findCoordinatesFromGridPosition(int row, int col, float *x, float *y) {
 	*x = roundf(*x);
 	*y = roundf(*y);
@@ -509,246 +319,224 @@ void findCoordinatesFromGridPosition(int row, int col, float *x, float *y) {
 	*y = Y_MIN + row * cellHeight + cellHeight / 2;
 }
 
-void transposeRowsBelowIndex(unsigned int grid[GRID_ROWS][GRID_COLS], int rowIndex) {
-	if (rowIndex <= 0 || rowIndex >= GRID_ROWS) {
-		printf("Invalid row index. It must be between 1 and %d.\n", GRID_ROWS - 1);
-		return;
-	}
-
-	for (int row = rowIndex - 1; row >= 0; --row) {
-		for (int col = 0; col < GRID_COLS; ++col) {
-			grid[row + 1][col] = grid[row][col];
-		}
-	}
+void translate_block(float x, float y, TransformComponent *transform) {
+	transform->x += x;
+	transform->y += y;
 }
 
-void printGrid(unsigned int grid[GRID_ROWS][GRID_COLS]) {
-	// Print the top border
-	printf("+");
-	for (int col = 0; col < GRID_COLS; ++col) {
-		printf("---+");
-	}
-	printf("\n");
+void place_block_at_cell(int row, int col, int rotation, TransformComponent *transform) {
+	float x = 0.0f, y = 0.0f;
+	findCoordinatesFromGridPosition(row, col, &x, &y);
 
-	for (int row = 0; row < GRID_ROWS; ++row) {
-		// Print row number
-		printf("%2d |", row); // Adjust '%2d' for alignment if you have more than 99 rows
+	initTransform(transform, x, y, glm_rad(-90.0f * rotation), TILE_SIZE, TILE_SIZE);
+}
 
-		// Print row data
-		for (int col = 0; col < GRID_COLS; ++col) {
-			printf(" %u |", grid[row][col]);
-		}
-		printf("\n");
+// Side of a shape's piece box, every rotation turns the cells a quarter around the box centre
+int piece_box_size(int shape) {
+	int size = 0;
 
-		// Print a separator line after each row
-		printf("+");
-		for (int col = 0; col < GRID_COLS; ++col) {
-			printf("---+");
-		}
-		printf("\n");
+	for (int i = 0; i < PIECE_CELLS; i++) {
+		int row = tetromino_defs[shape].cells[0][i][0];
+		int col = tetromino_defs[shape].cells[0][i][1];
+		size = row + 1 > size ? row + 1 : size;
+		size = col + 1 > size ? col + 1 : size;
 	}
+	return size;
 }
 
+void init_active_piece(GameState *gameState, ECS *ecs) {
+	gameState->ecs = ecs;
+	gameState->blockQuery = registerQuery(ecs, COMPONENT_BLOCK | COMPONENT_TRANSFORM, COMPONENT_NONE);
+	gameState->activePiece = createEntity(ecs);
+	addComponent(ecs, gameState->activePiece, COMPONENT_TYPE_MODEL);
+	initTransform(addComponent(ecs, gameState->activePiece, COMPONENT_TYPE_TRANSFORM), 0.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+
+	// The ghost's cells take the active cells' quads while shown
+	gameState->ghostPiece = createEntity(ecs);
+	addComponent(ecs, gameState->ghostPiece, COMPONENT_TYPE_MODEL);
+	initTransform(addComponent(ecs, gameState->ghostPiece, COMPONENT_TYPE_TRANSFORM), 0.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+
+	for (int i = 0; i < PIECE_CELLS; i++) {
+		EntityID cell = createEntity(ecs);
+		addComponent(ecs, cell, COMPONENT_TYPE_MODEL);
+		initTransform(addComponent(ecs, cell, COMPONENT_TYPE_TRANSFORM), 0.0f, 0.0f, 0.0f, TILE_SIZE, TILE_SIZE);
+		memset(addComponent(ecs, cell, COMPONENT_TYPE_VERTEX), 0, sizeof(VertexComponent));
+		memset(addComponent(ecs, cell, COMPONENT_TYPE_TEXTURE), 0, sizeof(TextureComponent));
+		SpriteComponent *sprite = addComponent(ecs, cell, COMPONENT_TYPE_SPRITE);
+		sprite->alpha = 0.0f;
+		sprite->layer = SPRITE_LAYER_GHOST;
+		setTransformParent(ecs, cell, gameState->ghostPiece);
+
+		gameState->ghostPieceCells[i] = cell;
+		gameState->activePieceCells[i] = ENTITY_NONE;
+	}
+}
 
+// Block prefab index of a shape's head (first) cell or one of its body cells
+int block_prefab_index(int shape, bool head) {
+	return shape * 2 + (head ? 0 : 1);
+}
 
-
-int findHighestRowWithAllOnes(unsigned int grid[GRID_ROWS][GRID_COLS]) {
-	int highestRow = -1; // Start with -1 to indicate no row found initially
-	for (int row = 0; row < GRID_ROWS; ++row) {
-		int allOnes = 1; // Flag to check if all values in the row are 1
-		for (int col = 0; col < GRID_COLS; ++col) {
-			if (grid[row][col] != 1) {
-				allOnes = 0; // Set flag to 0 if any column is not 1
-				break; // No need to check further columns in this row
-			}
-		}
-		if (allOnes) {
-			highestRow = row; // Update the highest row number
+// Builds every block prefab with its quad, spawning a piece only copies components
+void init_block_prefabs(GameState *gameState) {
+	for (int shape = 0; shape < TETROMINO_COUNT; shape++) {
+		for (int head = 1; head >= 0; head--) {
+			int index = block_prefab_index(shape, head);
+			Prefab *prefab = &gameState->blockPrefabs[index];
+			float tile_x = (float)(head ? TETROMINO_ATLAS_HEAD_X : TETROMINO_ATLAS_BODY_X);
+			float tile_y = (float)tetromino_defs[shape].atlasY;
+			VertexComponent vertex;
+
+			initPrefab(prefab);
+			glm_mat4_identity(((ModelComponent *)setPrefabComponent(prefab, COMPONENT_TYPE_MODEL))->model);
+			initTransform(setPrefabComponent(prefab, COMPONENT_TYPE_TRANSFORM), 0.0f, 0.0f, 0.0f, TILE_SIZE, TILE_SIZE);
+
+			build_sprite_quad(gameState->context, "atlas", tile_x, tile_y, TILE_SIZE, TILE_SIZE, &vertex);
+			*(VertexComponent *)setPrefabComponent(prefab, COMPONENT_TYPE_VERTEX) = vertex;
+
+			TextureComponent *texture = setPrefabComponent(prefab, COMPONENT_TYPE_TEXTURE);
+			strncpy(texture->path, "atlas", TEXTURE_PATH_SIZE - 1);
+			texture->textureId = get_texture_id_from_path(gameState->context, texture->path);
+
+			SpriteComponent *sprite = setPrefabComponent(prefab, COMPONENT_TYPE_SPRITE);
+			sprite->alpha = 1.0f;
+			sprite->layer = SPRITE_LAYER_BLOCKS;
+
+			((BlockComponent *)setPrefabComponent(prefab, COMPONENT_TYPE_BLOCK))->state = BLOCK_DESCENDING;
+
+			// Blocks start out in the falling piece, with the hierarchy already there attaching them
+			// doesn't move them again
+			HierarchyComponent *hierarchy = setPrefabComponent(prefab, COMPONENT_TYPE_HIERARCHY);
+			hierarchy->parent = ENTITY_NONE;
+			hierarchy->firstChild = ENTITY_NONE;
+			hierarchy->nextSibling = ENTITY_NONE;
 		}
 	}
-
-	return highestRow;
 }
 
+void free_block_prefabs(GameState *gameState) {
+	for (int i = 0; i < TETROMINO_COUNT * 2; i++) {
+		freePrefab(&gameState->blockPrefabs[i]);
+	}
+}
 
-void opengl_setup_camera(GameState *gameState) {
-	float right = SCREEN_WIDTH / 2;
-	float left = -right;
-	float top = SCREEN_HEIGHT / 2;
-	float bottom = -top;
-	float near = -1.0f;    // Near clipping plane
-	float far = 1.0f;      // Far clipping plane
+// Moves the falling piece to where the simulation has it
+void sync_active_piece_blocks(GameState *gameState) {
+	ActivePiece *piece = &gameState->sim.piece;
+	float centre = (piece_box_size(piece->shape) - 1) / 2.0f;
+	TransformComponent *transform = getComponent(gameState->ecs, gameState->activePiece, COMPONENT_TYPE_TRANSFORM);
 
-	glm_ortho(left, right, bottom, top, near, far, gameState->projection);
+	transform->x = X_MIN + (piece->col + centre) * TILE_SIZE + TILE_SIZE / 2;
+	transform->y = Y_MIN - (piece->row + centre) * TILE_SIZE - TILE_SIZE / 2;
+	transform->rotation = glm_rad(-90.0f * piece->rotation);
+	markComponentChanged(gameState->ecs, gameState->activePiece, COMPONENT_TYPE_TRANSFORM);
 }
 
+// Shows the falling piece's sprites faded on the row a hard drop would land it on. Hidden while no
+// piece is falling or when it already sits on that row.
+void sync_ghost_piece(GameState *gameState) {
+	ECS *ecs = gameState->ecs;
+	ActivePiece *piece = &gameState->sim.piece;
+	bool falling = gameState->action_queue == IDLE && !gameState->sim.gameOver && gameState->activePieceCells[0] != ENTITY_NONE;
+	int landing_row = falling ? sim_landing_row(&gameState->sim) : piece->row;
+	float alpha = landing_row != piece->row ? GHOST_PIECE_ALPHA : 0.0f;
+
+	for (int i = 0; i < PIECE_CELLS; i++) {
+		EntityID cell = gameState->ghostPieceCells[i];
+		SpriteComponent *sprite = getComponent(ecs, cell, COMPONENT_TYPE_SPRITE);
+
+		if (sprite->alpha != alpha) {
+			sprite->alpha = alpha;
+			markComponentChanged(ecs, cell, COMPONENT_TYPE_SPRITE);
+		}
 
-void calculateBoundingBox(GameState *gameState, float *bbox) {
-	int start_block_id = gameState->blocks.size - 4;
-	float min_x = 1e6, min_y = 1e6;
-	float max_x = -1e6, max_y = -1e6;
+		if (alpha > 0.0f) {
+			EntityID block = gameState->activePieceCells[i];
+			*(VertexComponent *)getComponent(ecs, cell, COMPONENT_TYPE_VERTEX) = *(VertexComponent *)getComponent(ecs, block, COMPONENT_TYPE_VERTEX);
+			*(TextureComponent *)getComponent(ecs, cell, COMPONENT_TYPE_TEXTURE) = *(TextureComponent *)getComponent(ecs, block, COMPONENT_TYPE_TEXTURE);
+		}
+	}
 
-	for (int i = start_block_id; i < start_block_id + 4; ++i) {
-		float x = gameState->blocks.array[i].model[3][0];
-		float y = gameState->blocks.array[i].model[3][1];
+	if (alpha > 0.0f) {
+		TransformComponent *active = getComponent(ecs, gameState->activePiece, COMPONENT_TYPE_TRANSFORM);
+		TransformComponent *ghost = getComponent(ecs, gameState->ghostPiece, COMPONENT_TYPE_TRANSFORM);
+		float y = active->y - (landing_row - piece->row) * TILE_SIZE;
 
-		if (x < min_x) min_x = x;
-		if (y < min_y) min_y = y;
-		if (x > max_x) max_x = x;
-		if (y > max_y) max_y = y;
+		if (ghost->x != active->x || ghost->y != y || ghost->rotation != active->rotation) {
+			*ghost = *active;
+			ghost->y = y;
+			markComponentChanged(ecs, gameState->ghostPiece, COMPONENT_TYPE_TRANSFORM);
+		}
 	}
-
-	bbox[0] = min_x;
-	bbox[1] = min_y;
-	bbox[2] = (max_x - min_x) + TILE_SIZE; // width
-	bbox[3] = (max_y - min_y) + TILE_SIZE; // height
-	bbox[4] = (min_x + max_x) / 2; // center_x
-	bbox[5] = (min_y + max_y) / 2; // center_y
 }
 
-void rotate_block_around_pivot(unsigned int pivot_id, unsigned int block_id, GameState *gameState, unsigned int center) {
-	vec3 rot = { 0.0f, 0.0f, 1.0f };
-	float bbox[6]; // x, y, width, height, center_x, center_y
-	calculateBoundingBox(gameState, bbox);
-
-	unsigned int pivot_id_start_offset = gameState->blocks.size - 4;
-
-	float move_to_x;
-	float move_to_y;
+void spawn_block(GameState *gameState) {
+	ECS *ecs = gameState->ecs;
+	ActivePiece *piece = &gameState->sim.piece;
+	float centre = (piece_box_size(piece->shape) - 1) / 2.0f;
+	EntityID blocks[PIECE_CELLS];
 
-	if (center == 1) {
-		move_to_x = bbox[4];
-		move_to_y = bbox[5];
-	}
-	else {
-		move_to_x = gameState->blocks.array[pivot_id_start_offset + pivot_id].model[3][0];
-		move_to_y = gameState->blocks.array[pivot_id_start_offset + pivot_id].model[3][1];
+	// The head cell and then the body cells, each made in one go
+	if (instantiatePrefab(ecs, &gameState->blockPrefabs[block_prefab_index(piece->shape, 1)], blocks, 1) != 1 ||
+		instantiatePrefab(ecs, &gameState->blockPrefabs[block_prefab_index(piece->shape, 0)], blocks + 1, PIECE_CELLS - 1) != PIECE_CELLS - 1) {
+		printf("Error: Could not spawn the next piece\n");
+		return;
 	}
 
-	// Calculate the translation needed to align B with A
-	float y_translation_needed = move_to_y - gameState->blocks.array[block_id].model[3][1];
-	float x_translation_needed = move_to_x - gameState->blocks.array[block_id].model[3][0];
-
-	vec3 world_vec = { x_translation_needed, y_translation_needed, 0.0f };
-	mat3 rotationMatrix;
-	glm_mat4_pick3(&gameState->blocks.array[block_id].model, rotationMatrix);
-
-	mat3 inverseRotationMatrix;
-	glm_mat3_inv(rotationMatrix, inverseRotationMatrix);
-
-	vec3 localVec;
-	glm_mat3_mulv(inverseRotationMatrix, world_vec, localVec);
-
-	glm_translate(&gameState->blocks.array[block_id].model, localVec);
-	glm_rotate(&gameState->blocks.array[block_id].model, glm_rad(-90.0f), rot);
-	glm_vec3_negate(localVec);
-	glm_translate(&gameState->blocks.array[block_id].model, localVec);
+	for (int i = 0; i < PIECE_CELLS; i++) {
+		EntityID block = blocks[i];
+		EntityID ghost = gameState->ghostPieceCells[i];
+
+		// Cells sit in the unrotated box, the piece's own rotation turns them. The ghost's are laid
+		// out the same.
+		float x = (tetromino_defs[piece->shape].cells[0][i][1] - centre) * TILE_SIZE;
+		float y = -(tetromino_defs[piece->shape].cells[0][i][0] - centre) * TILE_SIZE;
+		initTransform(getComponent(ecs, block, COMPONENT_TYPE_TRANSFORM), x, y, 0.0f, TILE_SIZE, TILE_SIZE);
+		markComponentChanged(ecs, block, COMPONENT_TYPE_TRANSFORM);
+		initTransform(getComponent(ecs, ghost, COMPONENT_TYPE_TRANSFORM), x, y, 0.0f, TILE_SIZE, TILE_SIZE);
+		markComponentChanged(ecs, ghost, COMPONENT_TYPE_TRANSFORM);
+
+		setTransformParent(ecs, block, gameState->activePiece);
+		gameState->activePieceCells[i] = block;
+	}
 
+	sync_active_piece_blocks(gameState);
 }
 
+// Leaves the falling piece's blocks on the cells it locked on, from here on each block has its own
+// transform. The next spawn makes new blocks.
+void lock_active_piece_blocks(GameState *gameState, int cells[PIECE_CELLS][2], int rotation) {
+	ECS *ecs = gameState->ecs;
 
-void translate_block(float x, float y, mat4 model) {
-	mat4 translationMatrix;
-	glm_translate_make(translationMatrix, (vec3){ x, y, 0.0f });
-	glm_mul(translationMatrix, model, model);
-}
+	for (int i = 0; i < PIECE_CELLS; i++) {
+		EntityID block = gameState->activePieceCells[i];
 
-void init_and_translate_block(unsigned int block_id, float tile_x, float tile_y, float trans_x, float trans_y, GameState *gameState) {
-	SingleBlock block;
-	glm_vec2_zero(block.velocity);
-	block.velocity[1] = -64.0f;
-	block.alpha = 1.0f;
-	block.currentState = BLOCK_DESCENDING;
-	block.renderComponent.tile_x = tile_x;
-	block.renderComponent.tile_y = tile_y;
-	addSingleBlock(&gameState->blocks, block);
-	opengl_init_block(&gameState->blocks.array[gameState->blocks.size - 1], gameState);
-	translate_block(trans_x - (TILE_SIZE / 2), -trans_y + (-TILE_SIZE / 2) + (SCREEN_HEIGHT / 2), gameState->blocks.array[gameState->blocks.size - 1].model);
-	//printf("created block %d relative xPos %f and yPos %f \n", gameState->num_blocks, gameState->blocks[gameState->num_blocks].model[3][0], gameState->blocks[gameState->num_blocks].model[3][1]);
-	//printf("created block %d absolute xPos %f and yPos %f \n", gameState->num_blocks, get_block_absolute_x(gameState->blocks[gameState->num_blocks].model), get_block_absolute_y(gameState->blocks[gameState->num_blocks].model));
-}
+		setTransformParent(ecs, block, ENTITY_NONE);
+		removeComponent(ecs, block, COMPONENT_TYPE_HIERARCHY);
+		place_block_at_cell(cells[i][0], cells[i][1], rotation, getComponent(ecs, block, COMPONENT_TYPE_TRANSFORM));
+		markComponentChanged(ecs, block, COMPONENT_TYPE_TRANSFORM);
+		((BlockComponent *)getComponent(ecs, block, COMPONENT_TYPE_BLOCK))->state = BLOCK_COLLIDED;
 
-void spawn_block(TetrominoShape shape, GameState *gameState) {
-	switch (shape) {
-	case TETROMINO_I:
-		printf("Processing I-shaped Tetromino\n");
-		init_and_translate_block(0, 0.0f, 0.0f, 0.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0f, 0.0f, 64.0f, 0.0f, gameState);
-		init_and_translate_block(2, 64.0f, 0.0f, 128.0f, 0.0f, gameState);
-		init_and_translate_block(3, 64.0f, 0.0f, 192.0f, 0.0f, gameState);
-		break;
-	case TETROMINO_O:
-		printf("Processing O-shaped Tetromino\n");
-		init_and_translate_block(0, 0.0f, 64.0f, 0.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0, 64.0f, 64.0f, 0.0f, gameState);
-		init_and_translate_block(2, 64.0f, 64.0f, 0.0f, 64.0f, gameState);
-		init_and_translate_block(3, 64.0f, 64.0f, 64.0f, 64.0f, gameState);
-		break;
-	case TETROMINO_T:
-		printf("Processing T-shaped Tetromino\n");
-		init_and_translate_block(0, 0.0f, 128.0f, 64.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0, 128.0f, 0.0f, 64.0f, gameState);
-		init_and_translate_block(2, 64.0f, 128.0f, 64.0f, 64.0f, gameState);
-		init_and_translate_block(3, 64.0f, 128.0f, 128.0f, 64.0f, gameState);
-		break;
-	case TETROMINO_J:
-		printf("Processing J-shaped Tetromino\n");
-		init_and_translate_block(0, 0.0f, 192.0f, 0.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0f, 192.0f, 0.0f, 64.0f, gameState);
-		init_and_translate_block(2, 64.0f, 192.0f, 64.0f, 64.0f, gameState);
-		init_and_translate_block(3, 64.0f, 192.0f, 128.0f, 64.0f, gameState);
-		break;
-	case TETROMINO_L:
-		init_and_translate_block(0, 0.0f, 256.0f, 128.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0f, 256.0f, 0.0f, 64.0f, gameState);
-		init_and_translate_block(2, 64.0f, 256.0f, 64.0f, 64.0f, gameState);
-		init_and_translate_block(3, 64.0f, 256.0f, 128.0f, 64.0f, gameState);
-
-		printf("Processing L-shaped Tetromino\n");
-		break;
-	case TETROMINO_S:
-		printf("Processing S-shaped Tetromino\n");
-		init_and_translate_block(0, 0.0f, 384.0f, 0.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0f, 384.0f, 64.0f, 0.0f, gameState);
-		init_and_translate_block(2, 64.0f, 384.0f, 64.0f, 64.0f, gameState);
-		init_and_translate_block(3, 64.0f, 384.0f, 128.0f, 64.0f, gameState);
-		break;
-	case TETROMINO_Z:
-		printf("Processing Z-shaped Tetromino\n");
-		init_and_translate_block(0, 0.0f, 320.0f, 64.0f, 0.0f, gameState);
-		init_and_translate_block(1, 64.0f, 320.0f, 128.0f, 0.0f, gameState);
-		init_and_translate_block(2, 64.0f, 320.0f, 0.0f, 64.0f, gameState);
-		init_and_translate_block(3, 64.0f, 320.0f, 64.0f, 64.0f, gameState);
-		break;
-	default:
-		printf("Unknown Tetromino Shape\n");
+		gameState->activePieceCells[i] = ENTITY_NONE;
 	}
 }
 
-
-TetrominoShape get_new_random_shape(TetrominoShape current_shape) {
-	TetrominoShape new_shape;
-	do {
-		new_shape = rand() % 2; // There are 7 different shapes
-	} while (new_shape == current_shape);
-
-	return new_shape;
-}
-
-void animateRowsDownwardStepCallback(GameState* gameState, SingleBlock **animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
+void animateRowsDownwardStepCallback(GameState* gameState, EntityID *animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
 	// Implement step logic
 	// Example: update the position and alpha of an object
 	for (int x = 0; x < *num_animation_objects; x++) {
-		SingleBlock *block = animation_objects[x];
-		translate_block(0.0f, properties[0].stepValue, *block->model);
+		TransformComponent *transform = getComponent(gameState->ecs, animation_objects[x], COMPONENT_TYPE_TRANSFORM);
+		float rows_to_drop = gameState->animations.rowDownwardsAnimation.animation_object_scales[x];
+		translate_block(0.0f, properties[0].stepValue * rows_to_drop, transform);
+		markComponentChanged(gameState->ecs, animation_objects[x], COMPONENT_TYPE_TRANSFORM);
 	}
 }
 
-void animateRowsDownwardCompletedCallback(GameState* gameState, SingleBlock **animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
+void animateRowsDownwardCompletedCallback(GameState* gameState, EntityID *animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
 	// Implement completion logic
 	printf("Animation completed!");
-	int highestRow = findHighestRowWithAllOnes(gameState->grid);
 
+	gameState->numClearedRows = 0;
 	gameState->action_queue = ROW_DESTROYED;
 	for (size_t i = 0; i < numProperties; i++) {
 		properties[i].currentValue = properties[i].startValue;
@@ -756,10 +544,10 @@ void animateRowsDownwardCompletedCallback(GameState* gameState, SingleBlock **an
 	}
 
 	for (int i = 0; i < *num_animation_objects; i++) {
-		SingleBlock *block = animation_objects[i];
+		TransformComponent *transform = getComponent(gameState->ecs, animation_objects[i], COMPONENT_TYPE_TRANSFORM);
 
 		// Calculate the nearest multiple of 64.0f
-		float value = block->model[3][1];
+		float value = transform->y;
 		float nearestMultiple;
 		if (value >= 0) {
 			nearestMultiple = round(value / 64.0f) * 64.0f;
@@ -768,77 +556,109 @@ void animateRowsDownwardCompletedCallback(GameState* gameState, SingleBlock **an
 			nearestMultiple = round(value / -64.0f) * -64.0f;
 		}
 
-		block->model[3][1] = nearestMultiple;
+		transform->y = nearestMultiple;
+		markComponentChanged(gameState->ecs, animation_objects[i], COMPONENT_TYPE_TRANSFORM);
 	}
 
-	transposeRowsBelowIndex(gameState->grid, highestRow);
-	initializeAnimObjectsPointerArray(animation_objects);
+	initializeAnimObjectsArray(animation_objects);
 	*num_animation_objects = 0;
 }
 
 
-void animateRowDesctructionStepCallback(GameState* gameState, SingleBlock **animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
+void animateRowDesctructionStepCallback(GameState* gameState, EntityID *animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
 	// Implement step logic
 	// Example: update the position and alpha of an object
 	for (int x = 0; x < *num_animation_objects; x++) {
-		SingleBlock *block = animation_objects[x];
+		TransformComponent *transform = getComponent(gameState->ecs, animation_objects[x], COMPONENT_TYPE_TRANSFORM);
+		SpriteComponent *sprite = getComponent(gameState->ecs, animation_objects[x], COMPONENT_TYPE_SPRITE);
 
 		// Calculate a factor that decreases as we move through the array
 		float fadeFactor = (float)(x + 0.4f) / *num_animation_objects;
 
 		// Apply the fade factor to the alpha value
-		block->alpha = properties[0].currentValue * fadeFactor;
+		sprite->alpha = properties[0].currentValue * fadeFactor;
 
 		// Apply the fade factor and the wave effect to the translation
-		translate_block(-64.0f * fadeFactor, 0.0f, block->model);
+		translate_block(-64.0f * fadeFactor, 0.0f, transform);
+		markComponentChanged(gameState->ecs, animation_objects[x], COMPONENT_TYPE_TRANSFORM);
+		markComponentChanged(gameState->ecs, animation_objects[x], COMPONENT_TYPE_SPRITE);
 	}
 }
 
-void animateRowDestructionCompletedCallback(GameState* gameState, SingleBlock **animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
+void animateRowDestructionCompletedCallback(GameState* gameState, EntityID *animation_objects, size_t *num_animation_objects, AnimationProperty* properties, size_t numProperties) {
 	// Implement completion logic
 	printf("Animation completed!");
-	int highestRow = findHighestRowWithAllOnes(gameState->grid);
-
 
+	// The blocks are destroyed by destroy_cleared_blocks_system on the next frame
 	for (int x = 0; x < *num_animation_objects; x++) {
-		SingleBlock *block = animation_objects[x];
-		removeSingleBlock(&gameState->blocks, block->model[3][0] , block->model[3][1]);
+		((BlockComponent *)getComponent(gameState->ecs, animation_objects[x], COMPONENT_TYPE_BLOCK))->state = BLOCK_CLEARED;
+		((SpriteComponent *)getComponent(gameState->ecs, animation_objects[x], COMPONENT_TYPE_SPRITE))->alpha = 0.0f;
+		markComponentChanged(gameState->ecs, animation_objects[x], COMPONENT_TYPE_SPRITE);
 	}
 
-	for (size_t i = 0; i < gameState->blocks.size; i++) {
-		SingleBlock *block = &gameState->blocks.array[i];
-		int row, col;
+	QueryIterator blocks;
+	queryBeginCached(&blocks, gameState->ecs, gameState->blockQuery);
+	while (queryNext(&blocks)) {
+		BlockComponent *states = blocks.columns[COMPONENT_TYPE_BLOCK];
+		TransformComponent *transforms = blocks.columns[COMPONENT_TYPE_TRANSFORM];
+
+		for (unsigned int i = 0; i < blocks.count; i++) {
+			int row, col;
 
-		findGridPosition(block->model[3][0], block->model[3][1], &row, &col);
+			if (states[i].state != BLOCK_COLLIDED) {
+				continue;
+			}
+
+			findGridPosition(transforms[i].x, transforms[i].y, &row, &col);
+
+			// Every cleared row below the block drops it by one row
+			int rows_to_drop = 0;
+			for (int r = 0; r < gameState->numClearedRows; r++) {
+				if (row < gameState->clearedRows[r]) {
+					rows_to_drop++;
+				}
+			}
 
-		if (row < highestRow) {
-			// Apply the translation
-			gameState->animations.rowDownwardsAnimation.num_animation_objects += 1;
-			gameState->animations.rowDownwardsAnimation.animation_objects[gameState->animations.rowDownwardsAnimation.num_animation_objects - 1] = block;
+			if (rows_to_drop > 0) {
+				Animation *descent = &gameState->animations.rowDownwardsAnimation;
+				descent->animation_objects[descent->num_animation_objects] = blocks.entities[i];
+				descent->animation_object_scales[descent->num_animation_objects] = (float)rows_to_drop;
+				descent->num_animation_objects += 1;
+			}
 		}
 	}
 
 
 	gameState->action_queue = START_ROW_DESCENT_ANIMATION;
 	gameState->animations.rowDownwardsAnimation.startTime = glfwGetTime();
-	initializeAnimObjectsPointerArray(animation_objects);
+	initializeAnimObjectsArray(animation_objects);
 	*num_animation_objects = 0;
 }
 
+// Records the destruction of every cleared block, the scheduler applies it once all systems are done
+void destroy_cleared_blocks_system(ECS *ecs, Scheduler *scheduler, CommandBuffer *commands, void *arg) {
+	GameState *gameState = arg;
+	QueryIterator blocks;
+	(void)scheduler;
 
+	queryBeginCached(&blocks, ecs, gameState->blockQuery);
+	while (queryNext(&blocks)) {
+		BlockComponent *states = blocks.columns[COMPONENT_TYPE_BLOCK];
+
+		for (unsigned int i = 0; i < blocks.count; i++) {
+			if (states[i].state == BLOCK_CLEARED) {
+				commandDestroyEntity(commands, blocks.entities[i]);
+			}
+		}
+	}
+}
 
 
-unsigned int initialize_sprite(ApplicationContext *context, char* texture, float tile_x, float tile_y, float tile_width, float tile_height ) {
-	float uv_coords[8];
-	SceneManager *sceneManager = context->sceneManager;
-	EntityID cameraId = context->activeCameraId;
-	
-	EntityID sprite = createEntity(sceneManager->currentScene);
-	ModelComponent model_component;
-	glm_mat4_identity(model_component.model);
 
-	VertexComponent vertex_component;
 
+// A textured quad showing one tile of the texture
+void build_sprite_quad(ApplicationContext *context, char* texture, float tile_x, float tile_y, float tile_width, float tile_height, VertexComponent *vertex) {
+	float uv_coords[8];
 	unsigned int texture_dimensions[2] = { 0, 0 };
 	get_texture_dimensions_from_id(context, texture, texture_dimensions);
 
@@ -859,48 +679,174 @@ unsigned int initialize_sprite(ApplicationContext *context, char* texture, float
 		1, 2, 3  // second triangle
 	};
 
-	OpenglComponent opengl_component;
-	opengl_component.VAO = 0;
-	opengl_component.VBO = 0;
-	opengl_component.VEO = 0;
+	memcpy(vertex->vertices, sprite_vertices, sizeof(sprite_vertices));
+	memcpy(vertex->indices, sprite_indices, sizeof(sprite_indices));
+}
+
+EntityID initialize_sprite(ApplicationContext *context, char* texture, float tile_x, float tile_y, float tile_width, float tile_height, unsigned int layer) {
+	SceneManager *sceneManager = context->sceneManager;
+	ECS *ecs = &sceneManager->currentScene->ecs;
+	
+	EntityID sprite = createEntity(ecs);
+	ModelComponent model_component;
+	glm_mat4_identity(model_component.model);
+
+	TransformComponent transform_component;
+	initTransform(&transform_component, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f);
 
-	memcpy(vertex_component.vertices, sprite_vertices, sizeof(sprite_vertices));
-	memcpy(vertex_component.indices, sprite_indices, sizeof(sprite_indices));
+	VertexComponent vertex_component;
+	build_sprite_quad(context, texture, tile_x, tile_y, tile_width, tile_height, &vertex_component);
 
 	TextureComponent texture_component;
-	texture_component.path = texture;
+	strncpy(texture_component.path, texture, TEXTURE_PATH_SIZE - 1);
+	texture_component.path[TEXTURE_PATH_SIZE - 1] = '\0';
 	texture_component.textureId = get_texture_id_from_path(context, texture_component.path);
 
-	sceneManager->currentScene->ecs.modelComponent[sprite] = model_component;
-	sceneManager->currentScene->ecs.vertexComponents[sprite] = vertex_component;
-	sceneManager->currentScene->ecs.openglComponents[sprite] = opengl_component;
-	sceneManager->currentScene->ecs.textureComponents[sprite] = texture_component;
+	SpriteComponent sprite_component;
+	sprite_component.alpha = 1.0f;
+	sprite_component.layer = layer;
 
-	setupShaderAndUniforms(context->shaderManager->programID, sceneManager->currentScene->ecs.modelComponent[cameraId].model, sceneManager->currentScene->ecs.modelComponent[sprite].model, 1.0f);
-	setupVertexData(&sceneManager->currentScene->ecs.openglComponents[sprite].VAO, &sceneManager->currentScene->ecs.openglComponents[sprite].VBO, &sceneManager->currentScene->ecs.openglComponents[sprite].VEO, sprite_vertices, sizeof(sprite_vertices), sprite_indices, sizeof(sprite_indices));
+	// Each add can move the entity's components
+	*(ModelComponent *)addComponent(ecs, sprite, COMPONENT_TYPE_MODEL) = model_component;
+	*(TransformComponent *)addComponent(ecs, sprite, COMPONENT_TYPE_TRANSFORM) = transform_component;
+	*(VertexComponent *)addComponent(ecs, sprite, COMPONENT_TYPE_VERTEX) = vertex_component;
+	*(TextureComponent *)addComponent(ecs, sprite, COMPONENT_TYPE_TEXTURE) = texture_component;
+	*(SpriteComponent *)addComponent(ecs, sprite, COMPONENT_TYPE_SPRITE) = sprite_component;
 
-	sceneManager->currentScene->ecs.entities[sprite].componentMask |= COMPONENT_MODEL;
-	sceneManager->currentScene->ecs.entities[sprite].componentMask |= COMPONENT_OPENGL;
-	sceneManager->currentScene->ecs.entities[sprite].componentMask |= COMPONENT_VERTEX;
-	sceneManager->currentScene->ecs.entities[sprite].componentMask |= COMPONENT_TEXTURE;
-	
 	return sprite;
 }
 
 void initialize_background(ApplicationContext *context) {
-	unsigned int spriteID = initialize_sprite(context, "bg", 0.0, 0.0, SCREEN_WIDTH, SCREEN_HEIGHT);
-	mat4 *model = context->sceneManager->currentScene->ecs.modelComponent[spriteID].model;
+	unsigned int spriteID = initialize_sprite(context, "bg", 0.0, 0.0, SCREEN_WIDTH, SCREEN_HEIGHT, SPRITE_LAYER_BACKGROUND);
+	TransformComponent *transform = getComponent(&context->sceneManager->currentScene->ecs, spriteID, COMPONENT_TYPE_TRANSFORM);
 
-	vec3 size = { SCREEN_WIDTH, SCREEN_HEIGHT, 1.0f };
-	glm_scale(context->sceneManager->currentScene->ecs.modelComponent[spriteID].model, size);
+	transform->scaleX = SCREEN_WIDTH;
+	transform->scaleY = SCREEN_HEIGHT;
+	markComponentChanged(&context->sceneManager->currentScene->ecs, spriteID, COMPONENT_TYPE_TRANSFORM);
+}
+
+// Draws every sprite, background, blocks and the ghost piece alike, a layer at a time and a chunk at
+// a time with their components in packed columns. The quads go through the sprite batch, so a layer
+// with one texture and alpha is a single draw call. Main thread only.
+void render_sprites_system(ECS *ecs, Scheduler *scheduler, CommandBuffer *commands, void *arg) {
+	ApplicationContext *context = arg;
+	ShaderManager *shaderManager = context->shaderManager;
+	SpriteBatch *batch = context->spriteBatch;
+	unsigned int cameraTick = getComponentTick(ecs, context->activeCameraId, COMPONENT_TYPE_MODEL);
+	QueryIterator sprites;
+	(void)scheduler;
+	(void)commands;
+
+	glUseProgram(shaderManager->programID);
+
+	// Uniforms stay set on the program, the projection only needs uploading when the camera changed
+	if (cameraTick > shaderManager->projectionTick) {
+		ModelComponent *camera_model = getComponent(ecs, context->activeCameraId, COMPONENT_TYPE_MODEL);
+		GLint projection_uniform_location = glGetUniformLocation(shaderManager->programID, "projection");
+		glUniformMatrix4fv(projection_uniform_location, 1, GL_FALSE, (float *)camera_model->model);
+		shaderManager->projectionTick = cameraTick;
+	}
+
+	beginSpriteBatch(batch, shaderManager->programID);
+	for (unsigned int layer = 0; layer < SPRITE_LAYER_COUNT; layer++) {
+		queryBeginCached(&sprites, ecs, context->spriteQuery);
+		while (queryNext(&sprites)) {
+			ModelComponent *models = sprites.columns[COMPONENT_TYPE_MODEL];
+			VertexComponent *vertices = sprites.columns[COMPONENT_TYPE_VERTEX];
+			TextureComponent *textures = sprites.columns[COMPONENT_TYPE_TEXTURE];
+			SpriteComponent *spriteComponents = sprites.columns[COMPONENT_TYPE_SPRITE];
+
+			for (unsigned int i = 0; i < sprites.count; i++) {
+				if (spriteComponents[i].layer == layer && spriteComponents[i].alpha > 0.0f) {
+					addSpriteToBatch(batch, &vertices[i], models[i].model, textures[i].textureId, spriteComponents[i].alpha);
+				}
+			}
+		}
+	}
+	flushSpriteBatch(batch);
+}
+
+// Snapshots save texture ids zeroed, sprites find theirs again by path
+void rebind_sprite_textures(ApplicationContext *context, ECS *ecs) {
+	QueryIterator sprites;
+
+	queryBegin(&sprites, ecs, COMPONENT_TEXTURE, COMPONENT_NONE);
+	while (queryNext(&sprites)) {
+		TextureComponent *textures = sprites.columns[COMPONENT_TYPE_TEXTURE];
+		for (unsigned int i = 0; i < sprites.count; i++) {
+			textures[i].textureId = get_texture_id_from_path(context, textures[i].path);
+		}
+	}
+}
+
+// The snapshot's user data, which of the ECS's entities make up the falling piece and its ghost
+typedef struct {
+	EntityID activePiece;
+	EntityID activePieceCells[PIECE_CELLS];
+	EntityID ghostPiece;
+	EntityID ghostPieceCells[PIECE_CELLS];
+} SavedPieces;
+
+// The blocks are in the ECS, loading only looks their texture ids up again
+void save_game_snapshot(GameState *gameState, ECS *ecs, const char *path) {
+	SavedPieces pieces;
+
+	pieces.activePiece = gameState->activePiece;
+	memcpy(pieces.activePieceCells, gameState->activePieceCells, sizeof(pieces.activePieceCells));
+	pieces.ghostPiece = gameState->ghostPiece;
+	memcpy(pieces.ghostPieceCells, gameState->ghostPieceCells, sizeof(pieces.ghostPieceCells));
+
+	if (snapshot_save(path, &gameState->sim, ecs, &pieces, sizeof(pieces))) {
+		printf("Game saved to %s\n", path);
+	}
+}
+
+void load_game_snapshot(GameState *gameState, ApplicationContext *context, ECS *ecs, const char *path) {
+	Snapshot snapshot;
+
+	if (!snapshot_open(&snapshot, path)) {
+		return;
+	}
+
+	if (snapshot.header->ecsSize == 0 || snapshot.header->userSize != sizeof(SavedPieces)) {
+		printf("Error: %s is not a saved game\n", path);
+		snapshot_close(&snapshot);
+		return;
+	}
+
+	// A failed restore leaves the ECS as it was or empty, either way its textures are looked up again
+	bool restored = snapshot_restore_ecs(&snapshot, ecs);
+	rebind_sprite_textures(context, ecs);
+	if (!restored) {
+		snapshot_close(&snapshot);
+		return;
+	}
+
+	// The ghost copies the restored cells' vertices and textures on the next sync_ghost_piece
+	SavedPieces pieces;
+	memcpy(&pieces, snapshot.userData, sizeof(pieces));
+	gameState->activePiece = pieces.activePiece;
+	memcpy(gameState->activePieceCells, pieces.activePieceCells, sizeof(gameState->activePieceCells));
+	gameState->ghostPiece = pieces.ghostPiece;
+	memcpy(gameState->ghostPieceCells, pieces.ghostPieceCells, sizeof(gameState->ghostPieceCells));
+
+	snapshot_state(&snapshot, &gameState->sim);
+	snapshot_close(&snapshot);
+
+	if (gameState->recordReplay) {
+		printf("Replay recording stopped, a loaded game can't be replayed from its seed\n");
+		gameState->recordReplay = 0;
+	}
+	printf("Game loaded from %s\n", path);
 }
 
 void initialize_tetromino_block(ApplicationContext *context) {
-	unsigned int spriteID = initialize_sprite(context, "atlas", 0, 0, TILE_SIZE, TILE_SIZE);
-	mat4 *model = context->sceneManager->currentScene->ecs.modelComponent[spriteID].model;
+	unsigned int spriteID = initialize_sprite(context, "atlas", 0, 0, TILE_SIZE, TILE_SIZE, SPRITE_LAYER_BLOCKS);
+	TransformComponent *transform = getComponent(&context->sceneManager->currentScene->ecs, spriteID, COMPONENT_TYPE_TRANSFORM);
 
-	vec3 size = { TILE_SIZE, TILE_SIZE, 1.0f };
-	glm_scale(context->sceneManager->currentScene->ecs.modelComponent[spriteID].model, size);
+	transform->scaleX = TILE_SIZE;
+	transform->scaleY = TILE_SIZE;
+	markComponentChanged(&context->sceneManager->currentScene->ecs, spriteID, COMPONENT_TYPE_TRANSFORM);
 }
 
 int main(void)
@@ -908,20 +854,19 @@ int main(void)
 	GLFWwindow* window;
 	GameState gameState;
 	gameState.action_queue = IDLE;
-	gameState.num_blocks = 0;
-	gameState.blocks.array = (SingleBlock *)malloc(10 * sizeof(SingleBlock));
-	gameState.blocks.size = 0;
-	gameState.blocks.capacity = 10;
 
 	window = opengl_create_window(&gameState);
-	gameState.current_shape = TETROMINO_I;
-	gameState.SHADER_PROGRAM = opengl_init_shaders();
-	opengl_setup_camera(&gameState);
 
-	initializeGrid(gameState.grid);
+	uint64_t seed = (uint64_t)time(NULL);
+	sim_init(&gameState.sim, seed);
+	replay_recorder_init(&gameState.replay, seed, REPLAY_DEFAULT_KEYFRAME_INTERVAL);
+	gameState.replayStartTime = glfwGetTime();
+	gameState.recordReplay = 1;
+	gameState.saveRequested = 0;
+	gameState.loadRequested = 0;
+	gameState.numClearedRows = 0;
 
 	float acceleration = 1.0f;
-	GLuint blocks_texture = opengl_load_texture_atlas("assets/atlas.jpg");
 
 	double lastTime = glfwGetTime();
 	int frame_counter = 0;
@@ -929,8 +874,6 @@ int main(void)
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetWindowUserPointer(window, &gameState);
 
-	spawn_block(gameState.current_shape, &gameState);
-
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
@@ -951,7 +894,7 @@ int main(void)
 	gameState.animations.rowDownwardsAnimation.stepCallback = animateRowsDownwardStepCallback;
 	gameState.animations.rowDownwardsAnimation.completeCallback = animateRowsDownwardCompletedCallback;
 	gameState.animations.rowDownwardsAnimation.num_animation_objects = 0;
-	initializeAnimObjectsPointerArray(gameState.animations.rowDownwardsAnimation.animation_objects);
+	initializeAnimObjectsArray(gameState.animations.rowDownwardsAnimation.animation_objects);
 	gameState.animations.rowDownwardsAnimation.type = ANIM_EASE_OUT_ELASTIC;
 
 	gameState.animations.rowDestructionAnimation.duration = 0.1f;
@@ -960,7 +903,7 @@ int main(void)
 	gameState.animations.rowDestructionAnimation.stepCallback = animateRowDesctructionStepCallback;
 	gameState.animations.rowDestructionAnimation.completeCallback = animateRowDestructionCompletedCallback;
 	gameState.animations.rowDestructionAnimation.num_animation_objects = 0;
-	initializeAnimObjectsPointerArray(gameState.animations.rowDestructionAnimation.animation_objects);
+	initializeAnimObjectsArray(gameState.animations.rowDestructionAnimation.animation_objects);
 	gameState.animations.rowDestructionAnimation.type = ANIM_EASE_OUT_BOUNCE;
 
 	ApplicationContext context;
@@ -971,20 +914,41 @@ int main(void)
 	context.sceneManager = sceneManager;
 	context.shaderManager = shaderManager;
 	context.textureManager = textureManager;
+	shaderManager->projectionTick = 0;
+	gameState.context = &context;
 
 	Scene firstLevel;
 	
 	sceneManager->currentScene = &firstLevel;
 
-	initECS(sceneManager->currentScene);
-	EntityID cameraId = createCamera(sceneManager->currentScene);
+	initECS(&sceneManager->currentScene->ecs, ECS_STORAGE_ARCHETYPE);
+	EntityID cameraId = createCamera(&sceneManager->currentScene->ecs);
 	setActiveCamera(cameraId, &context);
 	initShaders(&context);
+	SpriteBatch* spriteBatch = (SpriteBatch*)malloc(sizeof(SpriteBatch));
+	initSpriteBatch(spriteBatch, shaderManager->programID);
+	context.spriteBatch = spriteBatch;
 
 	load_textures(&context);
 	initialize_background(&context);
 	initialize_tetromino_block(&context);
 
+	// Per frame ECS work, systems touching disjoint components run in parallel
+	ECS *ecs = &sceneManager->currentScene->ecs;
+	TransformSystem transformSystem;
+	initTransformSystem(&transformSystem, ecs);
+	context.spriteQuery = registerQuery(ecs, COMPONENT_MODEL | COMPONENT_VERTEX | COMPONENT_TEXTURE | COMPONENT_SPRITE, COMPONENT_NONE);
+	init_active_piece(&gameState, ecs);
+	init_block_prefabs(&gameState);
+	spawn_block(&gameState);
+	context.scheduler = createScheduler(ecs, 0);
+	addSystem(context.scheduler, "compose transforms", composeTransformsSystem, &transformSystem,
+		COMPONENT_TRANSFORM, COMPONENT_MODEL, SYSTEM_NONE);
+	addSystem(context.scheduler, "render sprites", render_sprites_system, &context,
+		COMPONENT_MODEL | COMPONENT_VERTEX | COMPONENT_TEXTURE | COMPONENT_SPRITE | COMPONENT_CAMERA, COMPONENT_NONE, SYSTEM_MAIN_THREAD);
+	addSystem(context.scheduler, "destroy cleared blocks", destroy_cleared_blocks_system, &gameState,
+		COMPONENT_BLOCK | COMPONENT_TRANSFORM, COMPONENT_NONE, SYSTEM_NONE);
+
 	/* Loop until the user closes the window */
 	while (!glfwWindowShouldClose(window))
 	{
@@ -997,52 +961,25 @@ int main(void)
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		for (int x = 0; x < MAX_ENTITIES; x++) {
-			if ((sceneManager->currentScene->ecs.entities[x].componentMask & COMPONENT_OPENGL) != 0) {
-				opengl_set_current_texture(sceneManager->currentScene->ecs.textureComponents[x].textureId);
-				glBindVertexArray(sceneManager->currentScene->ecs.openglComponents[x].VAO);
-				glUseProgram(context.shaderManager->programID);
-				GLint model_uniform_location = glGetUniformLocation(context.shaderManager->programID, "model");
-				GLint projection_uniform_location = glGetUniformLocation(context.shaderManager->programID, "projection");
-				unsigned int activeCameraId = context.activeCameraId;
-				glUniformMatrix4fv(projection_uniform_location, 1, GL_FALSE, (float *)context.sceneManager->currentScene->ecs.modelComponent[activeCameraId].model);
-				glUniformMatrix4fv(model_uniform_location, 1, GL_FALSE, (float *)context.sceneManager->currentScene->ecs.modelComponent[x].model);
-				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-				glBindVertexArray(0);
-			}
-		}
-
-
-
-		//opengl_set_current_texture(bg_texture);
-		//glBindVertexArray(gameState.bg.renderComponent.VAO);
-		//glUseProgram(gameState.SHADER_PROGRAM);
-		//GLint model_uniform_location = glGetUniformLocation(gameState.SHADER_PROGRAM, "model");
-		//GLint projection_uniform_location = glGetUniformLocation(gameState.SHADER_PROGRAM, "projection");
-		GLint alphaLocation = glGetUniformLocation(gameState.SHADER_PROGRAM, "alpha");
-
-		//glUniformMatrix4fv(projection_uniform_location, 1, GL_FALSE, (float *)gameState.projection);
-		//glUniformMatrix4fv(model_uniform_location, 1, GL_FALSE, (float *)gameState.bg.model);
-		//glUniform1f(alphaLocation, (float) 1.0f);
-		//glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-		opengl_set_current_texture(blocks_texture);
-
-		for (size_t i = 0; i < gameState.blocks.size; i++) {
-
-			SingleBlock block = gameState.blocks.array[i];
-			glBindVertexArray(block.renderComponent.VAO);
-			glUniform1f(alphaLocation, (float)block.alpha);
-			opengl_translate_block(block.model, &gameState);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			glBindVertexArray(0);
-		}
+		sync_ghost_piece(&gameState);
+		runSystems(context.scheduler);
+		advanceChangeTick(ecs);
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 
+		if (gameState.saveRequested) {
+			save_game_snapshot(&gameState, ecs, QUICKSAVE_PATH);
+			gameState.saveRequested = 0;
+		}
+
+		if (gameState.loadRequested) {
+			load_game_snapshot(&gameState, &context, ecs, QUICKSAVE_PATH);
+			gameState.loadRequested = 0;
+		}
+
 
 		if (gameState.action_queue == START_ROW_DESCENT_ANIMATION) {
 			updateAnimation(&gameState.animations.rowDownwardsAnimation, &gameState, currentTime);
@@ -1055,19 +992,11 @@ int main(void)
 		frame_counter++;
 
 		if (gameState.action_queue == PLAYER_FINISHED_MOVE) {
-			for (unsigned int i = gameState.blocks.size - 4; i < gameState.blocks.size; i++){
-				setGridValue(gameState.grid, get_block_absolute_x(gameState.blocks.array[i].model), get_block_absolute_y(gameState.blocks.array[i].model), 1);
-				printf("ADDING BLOCK %f %f \n", get_block_absolute_x(gameState.blocks.array[i].model), get_block_absolute_y(gameState.blocks.array[i].model));
-			}
-
-			printf("So many blocks %d \n", gameState.blocks.size);
-
 			gameState.action_queue = CHECK_ROW_COMPLETION;
 		}
 
 		if (gameState.action_queue == CHECK_ROW_COMPLETION) {
-			int highestRow = findHighestRowWithAllOnes(gameState.grid);
-			if (highestRow != -1) {
+			if (gameState.numClearedRows > 0) {
 				gameState.action_queue = DESTROY_ROW;
 			}
 
@@ -1078,17 +1007,28 @@ int main(void)
 
 		if (gameState.action_queue == DESTROY_ROW) {
 			printf("DELETED ROW at %f", glfwGetTime());
-			int row_to_be_removed = findHighestRowWithAllOnes(gameState.grid);
 
-			for (size_t i = 0; i < gameState.blocks.size; i++) {
-				SingleBlock *block = &gameState.blocks.array[i];
-				int row, col;
+			QueryIterator blocks;
+			queryBeginCached(&blocks, ecs, gameState.blockQuery);
+			while (queryNext(&blocks)) {
+				TransformComponent *transforms = blocks.columns[COMPONENT_TYPE_TRANSFORM];
+
+				for (unsigned int i = 0; i < blocks.count; i++) {
+					int row, col;
+
+					findGridPosition(transforms[i].x, transforms[i].y, &row, &col);
 
-				findGridPosition(block->model[3][0], block->model[3][1], &row, &col);
+					bool in_cleared_row = 0;
+					for (int r = 0; r < gameState.numClearedRows; r++) {
+						if (row == gameState.clearedRows[r]) {
+							in_cleared_row = 1;
+						}
+					}
 
-				if (row == row_to_be_removed) {
-					gameState.animations.rowDestructionAnimation.num_animation_objects += 1;
-					gameState.animations.rowDestructionAnimation.animation_objects[gameState.animations.rowDestructionAnimation.num_animation_objects - 1] = block;
+					if (in_cleared_row) {
+						gameState.animations.rowDestructionAnimation.num_animation_objects += 1;
+						gameState.animations.rowDestructionAnimation.animation_objects[gameState.animations.rowDestructionAnimation.num_animation_objects - 1] = blocks.entities[i];
+					}
 				}
 			}
 
@@ -1103,10 +1043,12 @@ int main(void)
 
 
 		if (gameState.action_queue == SPAWN_NEXT_BLOCK) {
-			srand(time(NULL));
-			TetrominoShape new_shape = get_new_random_shape(gameState.current_shape);
-			gameState.current_shape = new_shape;
-			spawn_block(gameState.current_shape, &gameState);
+			if (gameState.sim.gameOver) {
+				printf("GAME OVER \n");
+			}
+			else {
+				spawn_block(&gameState);
+			}
 			gameState.action_queue = IDLE;
 		}
 
@@ -1115,48 +1057,57 @@ int main(void)
 		processInput(window);
 	}
 
-	free(gameState.blocks.array);
-	gameState.blocks.array = NULL;
-	gameState.blocks.size = gameState.blocks.capacity = 0;
+	if (gameState.recordReplay && gameState.replay.numInputs > 0 && replay_recorder_save(&gameState.replay, &gameState.sim, "last_game.replay")) {
+		printf("Replay saved to last_game.replay\n");
+	}
+	replay_recorder_free(&gameState.replay);
+	destroyScheduler(context.scheduler);
+	free_block_prefabs(&gameState);
+	freeECS(&sceneManager->currentScene->ecs);
+	freeSpriteBatch(spriteBatch);
+	free(spriteBatch);
 
 	glfwTerminate();
 	return 0;
 }
 
+void apply_player_input(GameState *gameState, SimInput input) {
+	if (gameState->action_queue != IDLE) {
+		return;
+	}
+
+	if (gameState->recordReplay) {
+		replay_recorder_add(&gameState->replay, &gameState->sim, input, (uint32_t)((glfwGetTime() - gameState->replayStartTime) * 1000.0));
+	}
+	int rotation = gameState->sim.piece.rotation;
+	SimStepResult result = sim_step(&gameState->sim, input);
+
+	if (result.events & SIM_EVENT_LOCKED) {
+		// The sim has already spawned the next piece, a hard drop still has to move the blocks down
+		lock_active_piece_blocks(gameState, result.lockedCells, rotation);
+	}
+	else if (result.events & SIM_EVENT_MOVED) {
+		sync_active_piece_blocks(gameState);
+	}
+
+	if (result.events & SIM_EVENT_LOCKED) {
+		printf("CAN'T MOVE DOWN ANYMORE! \n");
+
+		gameState->action_queue = PLAYER_FINISHED_MOVE;
+
+		memcpy(gameState->clearedRows, result.clearedRows, sizeof(gameState->clearedRows));
+		gameState->numClearedRows = result.numClearedRows;
+
+		board_print(&gameState->sim.board);
+
+		printf("DONE MOVEMENT \n");
+	}
+}
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	GameState* gameState = (GameState*)glfwGetWindowUserPointer(window);
 
-	int pivot_block = 0;
-	unsigned int pivot_around_center = 0;
-
-	switch (gameState->current_shape) {
-	case TETROMINO_I:
-		pivot_block = 1;
-		break;
-	case TETROMINO_O:
-		pivot_block = 1;
-		pivot_around_center = 1;
-		break;
-	case TETROMINO_T:
-		pivot_block = 2;
-		break;
-	case TETROMINO_J:
-		pivot_block = 2;
-		break;
-	case TETROMINO_L:
-		pivot_block = 2;
-		break;
-	case TETROMINO_S:
-		pivot_block = 1;
-		break;
-	case TETROMINO_Z:
-		pivot_block = 0;
-		break;
-	default:
-		printf("current shape is unknown");
-	}
-
 	if (action == GLFW_RELEASE) {
 		return;
 	}
@@ -1168,122 +1119,37 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 
 
 	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
-		printGrid(gameState->grid);
+		board_print(&gameState->sim.board);
 	}
 
 	if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) {
-		for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-			if (gameState->blocks.array[i].currentState != BLOCK_COLLIDED) {
-				printf("before: %f \n", gameState->blocks.array[i].model[3][1]);
-				rotate_block_around_pivot(pivot_block, i, gameState, pivot_around_center);
-				printf("after: %f \n", gameState->blocks.array[i].model[3][1]);
-			}
-		}
+		apply_player_input(gameState, SIM_INPUT_ROTATE);
 	}
 
 	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-		bool can_move_left = 1;
-
-		for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-			unsigned int row, col;
-			float x, y;
-			x = get_block_absolute_x(gameState->blocks.array[i].model);
-			y = get_block_absolute_y(gameState->blocks.array[i].model) - (TILE_SIZE - 1.0f);
-
-			findGridPosition(x, y, &row, &col);
-
-			if (gameState->grid[row][col - 1] == 1) {
-				can_move_left = 0;
-			}
-		}
-
-		if (can_move_left == 1) {
-			for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-				translate_block(-64.0f, 0.0f, gameState->blocks.array[i].model);
-			}
-		}
+		apply_player_input(gameState, SIM_INPUT_LEFT);
 	}
 
 	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-		bool can_move_right = 1;
-
-		for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-			unsigned int row1, row2, col;
-			float x, y1, y2;
-			x = get_block_absolute_x(gameState->blocks.array[i].model);
-			y1 = get_block_absolute_y(gameState->blocks.array[i].model);
-			y2 = get_block_absolute_y(gameState->blocks.array[i].model) - (TILE_SIZE - 1.0f);
-
-			findGridPosition(x, y1, &row1, &col);
-			findGridPosition(x, y2, &row2, &col);
-
-			printf("current block id %d \n", i);
-			printf("current row %d, col %d \n", row1, col);
-			printf("current grid block %d, next grid block %d \n", gameState->grid[row1][col], gameState->grid[row1][col + 1]);
-
-			if (gameState->grid[row1][col + 1] == 1) {
-				can_move_right = 0;
-			}
-
-			if (gameState->grid[row2][col + 1] == 1) {
-				can_move_right = 0;
-			}
-		}
-
-		if (can_move_right == 1) {
-			for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-				translate_block(64.0f, 0.0f, gameState->blocks.array[i].model);
-			}
-		}
+		apply_player_input(gameState, SIM_INPUT_RIGHT);
 	}
 
 	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
 		printf("Pressing down \n");
-		bool can_move_down = 1;
-
-		for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-			unsigned int row, col;
-			float x, y;
-			x = get_block_absolute_x(gameState->blocks.array[i].model);
-			y = get_block_absolute_y(gameState->blocks.array[i].model);
-
-			findGridPosition(x, y, &row, &col);
-
-			//printf("current block id %d \n", i);
-			//printf("current row %d, col %d \n", row, col);
-			//printf("current grid block %d, next grid block %d \n", gameState->grid[row][col], gameState->grid[row + 1][col]);
-
-			if (gameState->grid[row + 1][col] == 1) {
-				can_move_down = 0;
-			}
-
-			if (row + 1 == GRID_ROWS) {
-				can_move_down = 0;
-			}
-		}
-
-		if (can_move_down == 1) {
-			for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-				translate_block(0.0f, -64.0f, gameState->blocks.array[i].model);
-			}
-		}
-
-		else {
-			printf("CAN'T MOVE DOWN ANYMORE! \n");
-
-			gameState->action_queue = PLAYER_FINISHED_MOVE;
+		apply_player_input(gameState, SIM_INPUT_DOWN);
+	}
 
-			for (unsigned int i = gameState->blocks.size - 4; i < gameState->blocks.size; i++){
-				if (gameState->blocks.array[i].currentState != BLOCK_COLLIDED) {
-					gameState->blocks.array[i].currentState = BLOCK_COLLIDED;
-					gameState->blocks.array[i].velocity[1] = 0;
-				}
-			}
+	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+		apply_player_input(gameState, SIM_INPUT_HARD_DROP);
+	}
 
-			printGrid(gameState->grid);
+	// Save states, only between moves so no animation is holding blocks
+	if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS && gameState->action_queue == IDLE) {
+		gameState->saveRequested = 1;
+	}
 
-			printf("DONE MOVEMENT \n");
-		}
+	if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS && gameState->action_queue == IDLE) {
+		gameState->loadRequested = 1;
 	}
 }
 
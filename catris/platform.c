@@ -0,0 +1,231 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+	PlatformThreadFunc func;
+	void *arg;
+} ThreadStart;
+
+#ifdef _WIN32
+
+static DWORD WINAPI thread_entry(LPVOID param) {
+	ThreadStart start = *(ThreadStart *)param;
+	free(param);
+	start.func(start.arg);
+	return 0;
+}
+
+int platform_thread_create(PlatformThread *thread, PlatformThreadFunc func, void *arg) {
+	ThreadStart *start = malloc(sizeof(ThreadStart));
+	start->func = func;
+	start->arg = arg;
+
+	*thread = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+	if (*thread == NULL) {
+		free(start);
+		return 0;
+	}
+	return 1;
+}
+
+void platform_thread_join(PlatformThread thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+int platform_cpu_count(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+void platform_mutex_init(PlatformMutex *mutex) { InitializeCriticalSection(mutex); }
+void platform_mutex_destroy(PlatformMutex *mutex) { DeleteCriticalSection(mutex); }
+void platform_mutex_lock(PlatformMutex *mutex) { EnterCriticalSection(mutex); }
+void platform_mutex_unlock(PlatformMutex *mutex) { LeaveCriticalSection(mutex); }
+
+void platform_cond_init(PlatformCond *cond) { InitializeConditionVariable(cond); }
+void platform_cond_destroy(PlatformCond *cond) { (void)cond; }
+void platform_cond_wait(PlatformCond *cond, PlatformMutex *mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void platform_cond_broadcast(PlatformCond *cond) { WakeAllConditionVariable(cond); }
+
+long platform_atomic_add(volatile long *value, long amount) {
+	return InterlockedExchangeAdd(value, amount) + amount;
+}
+
+long platform_atomic_load(volatile long *value) {
+	return InterlockedCompareExchange(value, 0, 0);
+}
+
+double platform_time_seconds(void) {
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+const void *platform_map_file(const char *path, size_t *size) {
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER fileSize;
+	HANDLE mapping;
+	const void *data;
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return NULL;
+	}
+
+	// The view keeps the mapping alive after its handle is closed
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == NULL) {
+		return NULL;
+	}
+
+	*size = (size_t)fileSize.QuadPart;
+	return data;
+}
+
+void platform_unmap_file(const void *data, size_t size) {
+	(void)size;
+	UnmapViewOfFile(data);
+}
+
+void *platform_aligned_calloc(size_t alignment, size_t size) {
+	void *ptr = _aligned_malloc(size, alignment);
+	if (ptr != NULL) {
+		memset(ptr, 0, size);
+	}
+	return ptr;
+}
+
+void platform_aligned_free(void *ptr) {
+	_aligned_free(ptr);
+}
+
+#else
+
+static void *thread_entry(void *param) {
+	ThreadStart start = *(ThreadStart *)param;
+	free(param);
+	start.func(start.arg);
+	return NULL;
+}
+
+int platform_thread_create(PlatformThread *thread, PlatformThreadFunc func, void *arg) {
+	ThreadStart *start = malloc(sizeof(ThreadStart));
+	start->func = func;
+	start->arg = arg;
+
+	if (pthread_create(thread, NULL, thread_entry, start) != 0) {
+		free(start);
+		return 0;
+	}
+	return 1;
+}
+
+void platform_thread_join(PlatformThread thread) {
+	pthread_join(thread, NULL);
+}
+
+int platform_cpu_count(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+void platform_mutex_init(PlatformMutex *mutex) { pthread_mutex_init(mutex, NULL); }
+void platform_mutex_destroy(PlatformMutex *mutex) { pthread_mutex_destroy(mutex); }
+void platform_mutex_lock(PlatformMutex *mutex) { pthread_mutex_lock(mutex); }
+void platform_mutex_unlock(PlatformMutex *mutex) { pthread_mutex_unlock(mutex); }
+
+void platform_cond_init(PlatformCond *cond) { pthread_cond_init(cond, NULL); }
+void platform_cond_destroy(PlatformCond *cond) { pthread_cond_destroy(cond); }
+void platform_cond_wait(PlatformCond *cond, PlatformMutex *mutex) { pthread_cond_wait(cond, mutex); }
+void platform_cond_broadcast(PlatformCond *cond) { pthread_cond_broadcast(cond); }
+
+long platform_atomic_add(volatile long *value, long amount) {
+	return __atomic_add_fetch(value, amount, __ATOMIC_ACQ_REL);
+}
+
+long platform_atomic_load(volatile long *value) {
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+double platform_time_seconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+const void *platform_map_file(const char *path, size_t *size) {
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	void *data;
+
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	*size = (size_t)info.st_size;
+	return data;
+}
+
+void platform_unmap_file(const void *data, size_t size) {
+	munmap((void *)data, size);
+}
+
+void *platform_aligned_calloc(size_t alignment, size_t size) {
+	void *ptr;
+	if (posix_memalign(&ptr, alignment, size) != 0) {
+		return NULL;
+	}
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void platform_aligned_free(void *ptr) {
+	free(ptr);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Thin wrappers over the Win32 and POSIX threading, timing and file mapping APIs
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE PlatformThread;
+typedef CRITICAL_SECTION PlatformMutex;
+typedef CONDITION_VARIABLE PlatformCond;
+#define PLATFORM_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+
+typedef pthread_t PlatformThread;
+typedef pthread_mutex_t PlatformMutex;
+typedef pthread_cond_t PlatformCond;
+#define PLATFORM_THREAD_LOCAL __thread
+#endif
+
+// Data written by different threads goes on separate lines of this size to avoid false sharing
+#define PLATFORM_CACHE_LINE 64
+
+typedef void(*PlatformThreadFunc)(void *arg);
+
+int platform_thread_create(PlatformThread *thread, PlatformThreadFunc func, void *arg);
+void platform_thread_join(PlatformThread thread);
+int platform_cpu_count(void);
+
+void platform_mutex_init(PlatformMutex *mutex);
+void platform_mutex_destroy(PlatformMutex *mutex);
+void platform_mutex_lock(PlatformMutex *mutex);
+void platform_mutex_unlock(PlatformMutex *mutex);
+
+void platform_cond_init(PlatformCond *cond);
+void platform_cond_destroy(PlatformCond *cond);
+void platform_cond_wait(PlatformCond *cond, PlatformMutex *mutex);
+void platform_cond_broadcast(PlatformCond *cond);
+
+// Atomics return the value after the operation
+long platform_atomic_add(volatile long *value, long amount);
+long platform_atomic_load(volatile long *value);
+
+// Zeroed memory starting at a multiple of alignment, a power of two. Free it with platform_aligned_free.
+void *platform_aligned_calloc(size_t alignment, size_t size);
+void platform_aligned_free(void *ptr);
+
+// Monotonic clock
+double platform_time_seconds(void);
+
+// Read only view of a whole file, NULL if it can't be opened or is empty
+const void *platform_map_file(const char *path, size_t *size);
+void platform_unmap_file(const void *data, size_t size);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include "policy.h"
+#include "rng.h"
+
+// Random inputs, biased towards moving down so pieces keep locking
+
+typedef struct {
+	Rng rng;
+} RandomPolicy;
+
+static void random_reset(void *context, unsigned long long seed) {
+	RandomPolicy *policy = context;
+	// Games are seeded with the same value, jump so the inputs don't follow the piece stream
+	rng_seed(&policy->rng, seed);
+	rng_jump(&policy->rng);
+}
+
+static SimInput random_next_input(void *context, const SimState *state) {
+	int roll = (int)rng_range(&((RandomPolicy *)context)->rng, 8);
+	(void)state;
+
+	if (roll < 2) return SIM_INPUT_LEFT;
+	if (roll < 4) return SIM_INPUT_RIGHT;
+	if (roll < 5) return SIM_INPUT_ROTATE;
+	return SIM_INPUT_DOWN;
+}
+
+// Greedy placement: for every new piece try each rotation and column, drop it,
+// score the resulting board and then walk the piece there
+
+typedef struct {
+	unsigned int planPiece; // state->pieces when the plan was made
+	int hasPlan;
+	int targetRotation;
+	int targetCol;
+	int movesLeft;
+} GreedyPolicy;
+
+static void greedy_reset(void *context, unsigned long long seed) {
+	(void)seed;
+	memset(context, 0, sizeof(GreedyPolicy));
+}
+
+static float evaluate_board(const Board *board, int cleared) {
+	const uint8_t *heights = board->colHeights;
+	int aggregate_height = 0, holes = 0, bumpiness = 0;
+
+	for (int col = BOARD_FIRST_PLAYFIELD_COL; col <= BOARD_LAST_PLAYFIELD_COL; col++) {
+		aggregate_height += heights[col];
+		// Every empty cell below the surface is a hole
+		holes += heights[col] - board->colCounts[col];
+
+		if (col > BOARD_FIRST_PLAYFIELD_COL) {
+			int diff = heights[col] - heights[col - 1];
+			bumpiness += diff < 0 ? -diff : diff;
+		}
+	}
+
+	return -0.51f * aggregate_height + 0.76f * cleared - 0.36f * holes - 0.18f * bumpiness;
+}
+
+static void greedy_plan(GreedyPolicy *policy, const SimState *state) {
+	const ActivePiece *piece = &state->piece;
+	float best_score = -1e30f;
+
+	policy->hasPlan = 0;
+
+	for (int rotation = 0; rotation < TETROMINO_ROTATIONS; rotation++) {
+		const BoardRow *mask = tetromino_defs[piece->shape].masks[rotation];
+
+		for (int col = -2; col < GRID_COLS; col++) {
+			int row = piece->row;
+			int cleared_rows[BOARD_PIECE_ROWS];
+			Board board;
+
+			if (board_piece_overlaps(&state->board, mask, row, col)) {
+				continue;
+			}
+
+			row = board_landing_row(&state->board, mask, row, col);
+
+			board = state->board;
+			board_place_piece(&board, mask, row, col);
+			int cleared = board_clear_full_rows(&board, cleared_rows, BOARD_PIECE_ROWS);
+
+			float score = evaluate_board(&board, cleared);
+			if (score > best_score) {
+				best_score = score;
+				policy->hasPlan = 1;
+				policy->targetRotation = rotation;
+				policy->targetCol = col;
+			}
+		}
+	}
+
+	policy->planPiece = state->pieces;
+	policy->movesLeft = 2 * GRID_COLS;
+}
+
+static SimInput greedy_next_input(void *context, const SimState *state) {
+	GreedyPolicy *policy = context;
+	const ActivePiece *piece = &state->piece;
+
+	if (!policy->hasPlan || policy->planPiece != state->pieces) {
+		greedy_plan(policy, state);
+	}
+
+	// Give up on the plan when rotating or kicking gets in the way
+	if (!policy->hasPlan || policy->movesLeft <= 0) {
+		return SIM_INPUT_DOWN;
+	}
+	policy->movesLeft--;
+
+	if (piece->rotation != policy->targetRotation) {
+		return SIM_INPUT_ROTATE;
+	}
+	if (piece->col > policy->targetCol) {
+		return SIM_INPUT_LEFT;
+	}
+	if (piece->col < policy->targetCol) {
+		return SIM_INPUT_RIGHT;
+	}
+	return SIM_INPUT_HARD_DROP;
+}
+
+const SimPolicy sim_policy_random = { "random", sizeof(RandomPolicy), random_reset, random_next_input };
+const SimPolicy sim_policy_greedy = { "greedy", sizeof(GreedyPolicy), greedy_reset, greedy_next_input };
+
+const SimPolicy *sim_policy_find(const char *name) {
+	static const SimPolicy *policies[] = { &sim_policy_random, &sim_policy_greedy };
+
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+		if (strcmp(policies[i]->name, name) == 0) {
+			return policies[i];
+		}
+	}
+
+	return NULL;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stddef.h>
+
+#include "sim.h"
+
+// A move policy picks the next input for a game. Every game gets its own
+// zeroed context of contextSize bytes, which reset() seeds before the first move.
+
+typedef struct {
+	const char *name;
+	size_t contextSize;
+	void (*reset)(void *context, unsigned long long seed);
+	SimInput (*next_input)(void *context, const SimState *state);
+} SimPolicy;
+
+extern const SimPolicy sim_policy_random;
+extern const SimPolicy sim_policy_greedy;
+
+const SimPolicy *sim_policy_find(const char *name);
+
+#endif
\ No newline at end of file
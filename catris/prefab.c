@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefab.h"
+
+// Values are 16 byte aligned like the ECS's columns, matrices can be SIMD aligned
+static size_t alignSize(size_t size) {
+	return (size + 15) & ~(size_t)15;
+}
+
+void initPrefab(Prefab* prefab) {
+	memset(prefab, 0, sizeof(Prefab));
+}
+
+void freePrefab(Prefab* prefab) {
+	free(prefab->data);
+	initPrefab(prefab);
+}
+
+void* setPrefabComponent(Prefab* prefab, ComponentType type) {
+	if ((prefab->mask >> type) & 1u) {
+		return prefab->data + prefab->offsets[type];
+	}
+
+	size_t size = alignSize(getComponentSize(type));
+	unsigned char* data = realloc(prefab->data, prefab->dataSize + size);
+	if (data == NULL) {
+		printf("Error: Out of memory adding component %d to a prefab\n", type);
+		return NULL;
+	}
+
+	prefab->data = data;
+	prefab->offsets[type] = prefab->dataSize;
+	prefab->dataSize += size;
+	prefab->mask |= 1u << type;
+	memset(prefab->data + prefab->offsets[type], 0, size);
+	return prefab->data + prefab->offsets[type];
+}
+
+void* getPrefabComponent(Prefab* prefab, ComponentType type) {
+	if (!((prefab->mask >> type) & 1u)) {
+		return NULL;
+	}
+	return prefab->data + prefab->offsets[type];
+}
+
+unsigned int instantiatePrefab(ECS* ecs, const Prefab* prefab, EntityID* out, unsigned int count) {
+	for (unsigned int i = 0; i < count; ++i) {
+		EntityID id = createEntity(ecs);
+		if (id == ENTITY_NONE) {
+			return i;
+		}
+
+		if (!addComponents(ecs, id, prefab->mask)) {
+			destroyEntity(ecs, id);
+			return i;
+		}
+
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; ++type) {
+			if ((prefab->mask >> type) & 1u) {
+				memcpy(getComponent(ecs, id, (ComponentType)type), prefab->data + prefab->offsets[type], getComponentSize((ComponentType)type));
+			}
+		}
+		out[i] = id;
+	}
+	return count;
+}
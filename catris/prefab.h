@@ -0,0 +1,29 @@
+#ifndef PREFAB_H
+#define PREFAB_H
+
+#include "ecs.h"
+
+// A set of components with initial values that entities are stamped from. Instantiating adds all of
+// them in one move and copies the values in. The only handles a prefab holds are texture ids, its
+// instances share them and they stay owned by whoever made the prefab.
+typedef struct {
+	ComponentMask mask;
+	size_t offsets[COMPONENT_TYPE_COUNT]; // where each type's value starts in data
+	unsigned char *data;
+	size_t dataSize;
+} Prefab;
+
+void initPrefab(Prefab* prefab);
+void freePrefab(Prefab* prefab);
+
+// Adds a zeroed value for the type or returns the existing one, NULL when memory runs out.
+// Adding a type can move the values, earlier pointers into the prefab become invalid.
+void* setPrefabComponent(Prefab* prefab, ComponentType type);
+// NULL when the prefab doesn't have the type
+void* getPrefabComponent(Prefab* prefab, ComponentType type);
+
+// Creates count entities from the prefab and writes their handles to out. Returns how many were made,
+// fewer than count only when entities or memory run out.
+unsigned int instantiatePrefab(ECS* ecs, const Prefab* prefab, EntityID* out, unsigned int count);
+
+#endif
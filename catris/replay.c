@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "replay.h"
+
+static void keyframe_from_state(ReplayKeyframe *keyframe, const SimState *state, uint32_t input_index) {
+	memset(keyframe, 0, sizeof(ReplayKeyframe));
+	keyframe->inputIndex = input_index;
+	keyframe->pieces = state->pieces;
+	keyframe->lines = state->lines;
+	memcpy(keyframe->rng, state->rng.s, sizeof(keyframe->rng));
+	memcpy(keyframe->rows, state->board.rows, sizeof(keyframe->rows));
+	memcpy(keyframe->bagPieces, state->bag.pieces, sizeof(keyframe->bagPieces));
+	keyframe->bagHead = state->bag.head;
+	keyframe->bagCount = state->bag.count;
+	keyframe->shape = state->piece.shape;
+	keyframe->rotation = state->piece.rotation;
+	keyframe->row = state->piece.row;
+	keyframe->col = state->piece.col;
+	keyframe->gameOver = state->gameOver;
+}
+
+void replay_keyframe_state(const ReplayKeyframe *keyframe, SimState *state) {
+	state->pieces = keyframe->pieces;
+	state->lines = keyframe->lines;
+	memcpy(state->rng.s, keyframe->rng, sizeof(keyframe->rng));
+	memcpy(state->board.rows, keyframe->rows, sizeof(keyframe->rows));
+	board_recount(&state->board);
+	memcpy(state->bag.pieces, keyframe->bagPieces, sizeof(keyframe->bagPieces));
+	state->bag.head = keyframe->bagHead;
+	state->bag.count = keyframe->bagCount;
+	state->piece.shape = keyframe->shape;
+	state->piece.rotation = keyframe->rotation;
+	state->piece.row = keyframe->row;
+	state->piece.col = keyframe->col;
+	state->gameOver = keyframe->gameOver;
+}
+
+void replay_recorder_init(ReplayRecorder *recorder, uint64_t seed, uint32_t keyframe_interval) {
+	recorder->seed = seed;
+	recorder->keyframeInterval = keyframe_interval > 0 ? keyframe_interval : REPLAY_DEFAULT_KEYFRAME_INTERVAL;
+	recorder->inputs = NULL;
+	recorder->numInputs = 0;
+	recorder->inputCapacity = 0;
+	recorder->keyframes = NULL;
+	recorder->numKeyframes = 0;
+	recorder->keyframeCapacity = 0;
+}
+
+void replay_recorder_add(ReplayRecorder *recorder, const SimState *state, SimInput input, uint32_t time_ms) {
+	int keyframe = recorder->numInputs % recorder->keyframeInterval == 0;
+
+	// Both arrays grow before either is written, a failed add leaves the recording as it was
+	if (keyframe && recorder->numKeyframes == recorder->keyframeCapacity) {
+		uint32_t capacity = recorder->keyframeCapacity ? recorder->keyframeCapacity * 2 : 16;
+		ReplayKeyframe *keyframes = realloc(recorder->keyframes, capacity * sizeof(ReplayKeyframe));
+		if (keyframes == NULL) {
+			printf("Error: Out of memory recording replay keyframes\n");
+			return;
+		}
+		recorder->keyframes = keyframes;
+		recorder->keyframeCapacity = capacity;
+	}
+
+	if (recorder->numInputs == recorder->inputCapacity) {
+		uint32_t capacity = recorder->inputCapacity ? recorder->inputCapacity * 2 : 1024;
+		uint32_t *inputs = realloc(recorder->inputs, capacity * sizeof(uint32_t));
+		if (inputs == NULL) {
+			printf("Error: Out of memory recording replay inputs\n");
+			return;
+		}
+		recorder->inputs = inputs;
+		recorder->inputCapacity = capacity;
+	}
+
+	if (keyframe) {
+		keyframe_from_state(&recorder->keyframes[recorder->numKeyframes++], state, recorder->numInputs);
+	}
+	if (time_ms > REPLAY_MAX_TIME_MS) {
+		time_ms = REPLAY_MAX_TIME_MS;
+	}
+	recorder->inputs[recorder->numInputs++] = (time_ms << REPLAY_INPUT_BITS) | ((uint32_t)input & REPLAY_INPUT_MASK);
+}
+
+int replay_recorder_save(const ReplayRecorder *recorder, const SimState *final_state, const char *path) {
+	ReplayHeader header;
+	FILE *file;
+	int ok;
+
+	if (recorder->numKeyframes == 0) {
+		printf("Error: Replay has no inputs, nothing to save to %s\n", path);
+		return 0;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = REPLAY_MAGIC;
+	header.version = REPLAY_VERSION;
+	header.keyframeSize = (uint16_t)sizeof(ReplayKeyframe);
+	header.seed = recorder->seed;
+	header.numInputs = recorder->numInputs;
+	header.numKeyframes = recorder->numKeyframes;
+	header.keyframeInterval = recorder->keyframeInterval;
+	header.pieces = final_state->pieces;
+	header.lines = final_state->lines;
+	header.keyframesOffset = (uint32_t)(sizeof(ReplayHeader) + recorder->numInputs * sizeof(uint32_t));
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		printf("Error: Could not open %s for writing\n", path);
+		return 0;
+	}
+
+	ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(recorder->inputs, sizeof(uint32_t), recorder->numInputs, file) == recorder->numInputs
+		&& fwrite(recorder->keyframes, sizeof(ReplayKeyframe), recorder->numKeyframes, file) == recorder->numKeyframes;
+	ok = fclose(file) == 0 && ok;
+
+	if (!ok) {
+		printf("Error: Could not write replay to %s\n", path);
+	}
+	return ok;
+}
+
+void replay_recorder_free(ReplayRecorder *recorder) {
+	free(recorder->inputs);
+	free(recorder->keyframes);
+	recorder->inputs = NULL;
+	recorder->keyframes = NULL;
+	recorder->numInputs = recorder->inputCapacity = 0;
+	recorder->numKeyframes = recorder->keyframeCapacity = 0;
+}
+
+static int replay_is_valid(const void *data, size_t size) {
+	const ReplayHeader *header = data;
+	size_t inputsEnd;
+
+	if (size < sizeof(ReplayHeader) || header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION
+		|| header->keyframeSize != sizeof(ReplayKeyframe) || header->numKeyframes == 0) {
+		return 0;
+	}
+
+	inputsEnd = sizeof(ReplayHeader) + (size_t)header->numInputs * sizeof(uint32_t);
+	return header->keyframesOffset >= inputsEnd && header->keyframesOffset % sizeof(uint32_t) == 0
+		&& size >= header->keyframesOffset + (size_t)header->numKeyframes * sizeof(ReplayKeyframe);
+}
+
+int replay_open(Replay *replay, const char *path) {
+	memset(replay, 0, sizeof(Replay));
+	replay->data = platform_map_file(path, &replay->size);
+	if (replay->data == NULL) {
+		printf("Error: Could not map replay %s\n", path);
+		return 0;
+	}
+
+	if (!replay_is_valid(replay->data, replay->size)) {
+		printf("Error: %s is not a valid replay\n", path);
+		replay_close(replay);
+		return 0;
+	}
+
+	replay->header = replay->data;
+	replay->inputs = (const uint32_t *)((const char *)replay->data + sizeof(ReplayHeader));
+	replay->keyframes = (const ReplayKeyframe *)((const char *)replay->data + replay->header->keyframesOffset);
+	return 1;
+}
+
+void replay_close(Replay *replay) {
+	if (replay->data != NULL) {
+		platform_unmap_file(replay->data, replay->size);
+	}
+	memset(replay, 0, sizeof(Replay));
+}
+
+SimInput replay_input(const Replay *replay, uint32_t index) {
+	return (SimInput)(replay->inputs[index] & REPLAY_INPUT_MASK);
+}
+
+uint32_t replay_input_time(const Replay *replay, uint32_t index) {
+	return replay->inputs[index] >> REPLAY_INPUT_BITS;
+}
+
+void replay_seek(const Replay *replay, SimState *state, uint32_t index) {
+	// Last keyframe at or before index
+	uint32_t low = 0;
+	uint32_t high = replay->header->numKeyframes;
+
+	if (index > replay->header->numInputs) {
+		index = replay->header->numInputs;
+	}
+
+	while (high - low > 1) {
+		uint32_t mid = low + (high - low) / 2;
+		if (replay->keyframes[mid].inputIndex <= index) {
+			low = mid;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	replay_keyframe_state(&replay->keyframes[low], state);
+
+	for (uint32_t i = replay->keyframes[low].inputIndex; i < index; i++) {
+		sim_step(state, replay_input(replay, i));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+// Binary replay: the game seed plus every input with its time, and a copy of the
+// sim state every keyframeInterval inputs so a player can seek without starting over.
+// File layout (little endian): ReplayHeader, numInputs packed inputs, numKeyframes ReplayKeyframes.
+// Everything is fixed size and aligned so the file is read in place from a memory map.
+
+#define REPLAY_MAGIC 0x50525443 // "CTRP"
+#define REPLAY_VERSION 1
+#define REPLAY_DEFAULT_KEYFRAME_INTERVAL 256
+
+// An input is packed as (time in ms << REPLAY_INPUT_BITS) | SimInput
+#define REPLAY_INPUT_BITS 3
+#define REPLAY_INPUT_MASK ((1u << REPLAY_INPUT_BITS) - 1)
+#define REPLAY_MAX_TIME_MS (UINT32_MAX >> REPLAY_INPUT_BITS)
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t keyframeSize; // sizeof(ReplayKeyframe), changes with the board size
+	uint64_t seed;
+	uint32_t numInputs;
+	uint32_t numKeyframes;
+	uint32_t keyframeInterval;
+	// Final result, so scans don't have to simulate
+	uint32_t pieces;
+	uint32_t lines;
+	uint32_t keyframesOffset;
+} ReplayHeader;
+
+// SimState with fixed width fields, the state right before inputs[inputIndex] is applied
+typedef struct {
+	uint32_t inputIndex;
+	uint32_t pieces;
+	uint32_t lines;
+	uint32_t rng[4];
+	BoardRow rows[GRID_ROWS];
+	uint8_t bagPieces[BAG_CAPACITY];
+	uint8_t bagHead;
+	uint8_t bagCount;
+	uint8_t shape;
+	uint8_t rotation;
+	int8_t row;
+	int8_t col;
+	uint8_t gameOver;
+	uint8_t padding;
+} ReplayKeyframe;
+
+typedef struct {
+	uint64_t seed;
+	uint32_t keyframeInterval;
+	uint32_t *inputs;
+	uint32_t numInputs;
+	uint32_t inputCapacity;
+	ReplayKeyframe *keyframes;
+	uint32_t numKeyframes;
+	uint32_t keyframeCapacity;
+} ReplayRecorder;
+
+typedef struct {
+	const void *data;
+	size_t size;
+	const ReplayHeader *header;
+	const uint32_t *inputs;
+	const ReplayKeyframe *keyframes;
+} Replay;
+
+// Recording, call replay_recorder_add with the state before every sim_step
+void replay_recorder_init(ReplayRecorder *recorder, uint64_t seed, uint32_t keyframe_interval);
+void replay_recorder_add(ReplayRecorder *recorder, const SimState *state, SimInput input, uint32_t time_ms);
+int replay_recorder_save(const ReplayRecorder *recorder, const SimState *final_state, const char *path);
+void replay_recorder_free(ReplayRecorder *recorder);
+
+// Playback, returns 0 if the file can't be mapped or isn't a valid replay
+int replay_open(Replay *replay, const char *path);
+void replay_close(Replay *replay);
+SimInput replay_input(const Replay *replay, uint32_t index);
+uint32_t replay_input_time(const Replay *replay, uint32_t index);
+// Sets state to the game right before input index, starting from the closest keyframe
+void replay_seek(const Replay *replay, SimState *state, uint32_t index);
+void replay_keyframe_state(const ReplayKeyframe *keyframe, SimState *state);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "rng.h"
+
+static uint32_t rotl(const uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, uint64_t seed) {
+	uint64_t a = splitmix64(&seed);
+	uint64_t b = splitmix64(&seed);
+
+	rng->s[0] = (uint32_t)a;
+	rng->s[1] = (uint32_t)(a >> 32);
+	rng->s[2] = (uint32_t)b;
+	rng->s[3] = (uint32_t)(b >> 32);
+}
+
+uint32_t rng_next(Rng *rng) {
+	uint32_t *s = rng->s;
+	const uint32_t result = rotl(s[1] * 5, 7) * 9;
+	const uint32_t t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+
+	return result;
+}
+
+uint32_t rng_range(Rng *rng, uint32_t bound) {
+	// Lemire's multiply and reject, no modulo bias
+	uint64_t m = (uint64_t)rng_next(rng) * bound;
+	uint32_t low = (uint32_t)m;
+
+	if (low < bound) {
+		uint32_t threshold = (0u - bound) % bound;
+		while (low < threshold) {
+			m = (uint64_t)rng_next(rng) * bound;
+			low = (uint32_t)m;
+		}
+	}
+
+	return (uint32_t)(m >> 32);
+}
+
+void rng_jump(Rng *rng) {
+	static const uint32_t JUMP[] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+	uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+	for (int i = 0; i < 4; i++) {
+		for (int b = 0; b < 32; b++) {
+			if (JUMP[i] & (1u << b)) {
+				s0 ^= rng->s[0];
+				s1 ^= rng->s[1];
+				s2 ^= rng->s[2];
+				s3 ^= rng->s[3];
+			}
+			rng_next(rng);
+		}
+	}
+
+	rng->s[0] = s0;
+	rng->s[1] = s1;
+	rng->s[2] = s2;
+	rng->s[3] = s3;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// xoshiro128** generator, small enough to live inside every game state
+
+typedef struct {
+	uint32_t s[4];
+} Rng;
+
+// Expands the seed with splitmix64 so neighbouring seeds give unrelated streams
+void rng_seed(Rng *rng, uint64_t seed);
+uint32_t rng_next(Rng *rng);
+// Uniform value in [0, bound)
+uint32_t rng_range(Rng *rng, uint32_t bound);
+// Advances the stream by 2^64 values, use it to split one seed into non-overlapping streams
+void rng_jump(Rng *rng);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "scheduler.h"
+#include "thread_pool.h"
+
+typedef struct {
+	Scheduler* scheduler;
+	const char* name;
+	SystemFunc func;
+	void* context;
+	ComponentMask reads;
+	ComponentMask writes;
+	unsigned int flags;
+	uint32_t dependsOn;  // bit i: waits for system i
+	uint32_t dependents; // bit i: system i waits for this one
+	CommandBuffer commands;
+	volatile long waitingOn; // unfinished dependencies during a run
+} System;
+
+struct Scheduler {
+	ECS* ecs;
+	ThreadPool* pool; // NULL runs everything on the calling thread
+	System systems[SCHEDULER_MAX_SYSTEMS];
+	unsigned int numSystems;
+	// Run state, guarded by lock
+	PlatformMutex lock;
+	PlatformCond cond;
+	uint32_t mainThreadReady;
+	unsigned int numFinished;
+};
+
+// One parallelFor call. Whoever takes part claims ranges until none are left, the caller then waits
+// for ranges still running elsewhere. Helpers may start after that, so the job is reference counted.
+typedef struct {
+	ParallelForFunc func;
+	void* arg;
+	unsigned int count;
+	unsigned int grain;
+	long numRanges;
+	volatile long nextRange;
+	volatile long doneRanges;
+	volatile long refs;
+	PlatformMutex lock;
+	PlatformCond doneCond;
+} ParallelForJob;
+
+typedef struct {
+	QueryIterator* spans;
+	QuerySpanFunc func;
+	void* arg;
+} ParallelQueryJob;
+
+static bool systemsConflict(const System* a, const System* b) {
+	return (a->flags & SYSTEM_EXCLUSIVE) || (b->flags & SYSTEM_EXCLUSIVE)
+		|| (a->writes & (b->reads | b->writes)) || (b->writes & a->reads);
+}
+
+static int countBits(uint32_t bits) {
+	int count = 0;
+	for (; bits; bits &= bits - 1) {
+		count++;
+	}
+	return count;
+}
+
+Scheduler* createScheduler(ECS* ecs, int num_threads) {
+	Scheduler* scheduler = malloc(sizeof(Scheduler));
+	if (scheduler == NULL) {
+		printf("Error: Out of memory creating the scheduler\n");
+		return NULL;
+	}
+
+	scheduler->ecs = ecs;
+	scheduler->pool = num_threads == 1 ? NULL : thread_pool_create(num_threads);
+	scheduler->numSystems = 0;
+	scheduler->mainThreadReady = 0;
+	scheduler->numFinished = 0;
+	platform_mutex_init(&scheduler->lock);
+	platform_cond_init(&scheduler->cond);
+	return scheduler;
+}
+
+void destroyScheduler(Scheduler* scheduler) {
+	if (scheduler->pool != NULL) {
+		thread_pool_destroy(scheduler->pool);
+	}
+	for (unsigned int i = 0; i < scheduler->numSystems; ++i) {
+		freeCommandBuffer(&scheduler->systems[i].commands);
+	}
+	platform_cond_destroy(&scheduler->cond);
+	platform_mutex_destroy(&scheduler->lock);
+	free(scheduler);
+}
+
+int addSystem(Scheduler* scheduler, const char* name, SystemFunc func, void* context,
+	ComponentMask reads, ComponentMask writes, unsigned int flags) {
+	if (scheduler->numSystems == SCHEDULER_MAX_SYSTEMS) {
+		printf("Error: Can't add system %s, the scheduler is full\n", name);
+		return -1;
+	}
+
+	unsigned int index = scheduler->numSystems++;
+	System* system = &scheduler->systems[index];
+	system->scheduler = scheduler;
+	system->name = name;
+	system->func = func;
+	system->context = context;
+	system->reads = reads;
+	system->writes = writes;
+	system->flags = flags;
+	system->dependsOn = 0;
+	system->dependents = 0;
+	initCommandBuffer(&system->commands);
+
+	// Only earlier systems are checked, so the graph follows registration order and has no cycles
+	for (unsigned int i = 0; i < index; ++i) {
+		if (systemsConflict(&scheduler->systems[i], system)) {
+			system->dependsOn |= 1u << i;
+			scheduler->systems[i].dependents |= 1u << index;
+		}
+	}
+
+	return (int)index;
+}
+
+static void runSystemTask(void* arg);
+
+static void systemReady(Scheduler* scheduler, unsigned int index) {
+	if (scheduler->systems[index].flags & SYSTEM_MAIN_THREAD) {
+		platform_mutex_lock(&scheduler->lock);
+		scheduler->mainThreadReady |= 1u << index;
+		platform_cond_broadcast(&scheduler->cond);
+		platform_mutex_unlock(&scheduler->lock);
+	}
+	else {
+		thread_pool_submit(scheduler->pool, runSystemTask, &scheduler->systems[index]);
+	}
+}
+
+static void systemFinished(Scheduler* scheduler, const System* system) {
+	for (uint32_t dependents = system->dependents; dependents; dependents &= dependents - 1) {
+		unsigned int index = 0;
+		while (!((dependents >> index) & 1u)) {
+			index++;
+		}
+		if (platform_atomic_add(&scheduler->systems[index].waitingOn, -1) == 0) {
+			systemReady(scheduler, index);
+		}
+	}
+
+	platform_mutex_lock(&scheduler->lock);
+	scheduler->numFinished++;
+	platform_cond_broadcast(&scheduler->cond);
+	platform_mutex_unlock(&scheduler->lock);
+}
+
+static void runSystemTask(void* arg) {
+	System* system = arg;
+	system->func(system->scheduler->ecs, system->scheduler, &system->commands, system->context);
+	systemFinished(system->scheduler, system);
+}
+
+// The sync point, nothing runs while the recorded changes are applied
+static void applySystemCommands(Scheduler* scheduler) {
+	for (unsigned int i = 0; i < scheduler->numSystems; ++i) {
+		applyCommands(scheduler->ecs, &scheduler->systems[i].commands);
+	}
+}
+
+void runSystems(Scheduler* scheduler) {
+	if (scheduler->pool == NULL) {
+		for (unsigned int i = 0; i < scheduler->numSystems; ++i) {
+			System* system = &scheduler->systems[i];
+			system->func(scheduler->ecs, scheduler, &system->commands, system->context);
+		}
+		applySystemCommands(scheduler);
+		return;
+	}
+
+	uint32_t roots = 0;
+
+	scheduler->mainThreadReady = 0;
+	scheduler->numFinished = 0;
+	for (unsigned int i = 0; i < scheduler->numSystems; ++i) {
+		scheduler->systems[i].waitingOn = countBits(scheduler->systems[i].dependsOn);
+		if (scheduler->systems[i].dependsOn == 0) {
+			roots |= 1u << i;
+		}
+	}
+
+	// Roots are picked before any starts, a finishing system readies its own dependents
+	for (unsigned int i = 0; i < scheduler->numSystems; ++i) {
+		if ((roots >> i) & 1u) {
+			systemReady(scheduler, i);
+		}
+	}
+
+	// The calling thread runs the main thread systems as they become ready, in registration order
+	platform_mutex_lock(&scheduler->lock);
+	while (scheduler->numFinished < scheduler->numSystems) {
+		if (scheduler->mainThreadReady == 0) {
+			platform_cond_wait(&scheduler->cond, &scheduler->lock);
+			continue;
+		}
+
+		unsigned int index = 0;
+		while (!((scheduler->mainThreadReady >> index) & 1u)) {
+			index++;
+		}
+		scheduler->mainThreadReady &= ~(1u << index);
+		platform_mutex_unlock(&scheduler->lock);
+
+		System* system = &scheduler->systems[index];
+		system->func(scheduler->ecs, scheduler, &system->commands, system->context);
+		systemFinished(scheduler, system);
+
+		platform_mutex_lock(&scheduler->lock);
+	}
+	platform_mutex_unlock(&scheduler->lock);
+
+	applySystemCommands(scheduler);
+}
+
+static void releaseParallelForJob(ParallelForJob* job) {
+	if (platform_atomic_add(&job->refs, -1) == 0) {
+		platform_cond_destroy(&job->doneCond);
+		platform_mutex_destroy(&job->lock);
+		free(job);
+	}
+}
+
+static void runParallelForRanges(ParallelForJob* job) {
+	for (;;) {
+		long range = platform_atomic_add(&job->nextRange, 1) - 1;
+		if (range >= job->numRanges) {
+			break;
+		}
+
+		unsigned int begin = (unsigned int)range * job->grain;
+		unsigned int end = job->count - begin > job->grain ? begin + job->grain : job->count;
+		job->func(begin, end, job->arg);
+
+		if (platform_atomic_add(&job->doneRanges, 1) == job->numRanges) {
+			platform_mutex_lock(&job->lock);
+			platform_cond_broadcast(&job->doneCond);
+			platform_mutex_unlock(&job->lock);
+		}
+	}
+}
+
+static void parallelForTask(void* arg) {
+	ParallelForJob* job = arg;
+	runParallelForRanges(job);
+	releaseParallelForJob(job);
+}
+
+void parallelFor(Scheduler* scheduler, unsigned int count, unsigned int grain, ParallelForFunc func, void* arg) {
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	long num_ranges = (long)((count + (grain - 1)) / grain);
+	ParallelForJob* job = NULL;
+
+	if (scheduler != NULL && scheduler->pool != NULL && num_ranges > 1) {
+		job = malloc(sizeof(ParallelForJob));
+	}
+
+	// Not worth splitting, or no memory to split with
+	if (job == NULL) {
+		if (count > 0) {
+			func(0, count, arg);
+		}
+		return;
+	}
+
+	long helpers = num_ranges - 1 < scheduler->pool->numThreads ? num_ranges - 1 : scheduler->pool->numThreads;
+	job->func = func;
+	job->arg = arg;
+	job->count = count;
+	job->grain = grain;
+	job->numRanges = num_ranges;
+	job->nextRange = 0;
+	job->doneRanges = 0;
+	job->refs = helpers + 1;
+	platform_mutex_init(&job->lock);
+	platform_cond_init(&job->doneCond);
+
+	for (long i = 0; i < helpers; ++i) {
+		thread_pool_submit(scheduler->pool, parallelForTask, job);
+	}
+
+	runParallelForRanges(job);
+
+	platform_mutex_lock(&job->lock);
+	while (platform_atomic_load(&job->doneRanges) < num_ranges) {
+		platform_cond_wait(&job->doneCond, &job->lock);
+	}
+	platform_mutex_unlock(&job->lock);
+
+	releaseParallelForJob(job);
+}
+
+static void parallelQueryRange(unsigned int begin, unsigned int end, void* arg) {
+	ParallelQueryJob* job = arg;
+	for (unsigned int i = begin; i < end; ++i) {
+		job->func(&job->spans[i], job->arg);
+	}
+}
+
+void parallelQuery(Scheduler* scheduler, QueryIterator* query, QuerySpanFunc func, void* arg) {
+	ParallelQueryJob job;
+	unsigned int num_spans = 0;
+	unsigned int capacity = 0;
+
+	job.spans = NULL;
+	job.func = func;
+	job.arg = arg;
+
+	if (scheduler == NULL) {
+		while (queryNext(query)) {
+			func(query, arg);
+		}
+		return;
+	}
+
+	// Spans are cheap to find, collect them up front so the workers can split them
+	while (queryNext(query)) {
+		if (num_spans == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			QueryIterator* spans = realloc(job.spans, capacity * sizeof(QueryIterator));
+			if (spans == NULL) {
+				// Out of memory, finish on this thread
+				parallelQueryRange(0, num_spans, &job);
+				do {
+					func(query, arg);
+				} while (queryNext(query));
+				free(job.spans);
+				return;
+			}
+			job.spans = spans;
+		}
+		job.spans[num_spans++] = *query;
+	}
+
+	// Archetype spans are whole chunks, sparse spans single entities
+	unsigned int grain = scheduler->ecs->storage == ECS_STORAGE_ARCHETYPE ? 1 : ECS_CHUNK_CAPACITY;
+	parallelFor(scheduler, num_spans, grain, parallelQueryRange, &job);
+	free(job.spans);
+}
@@ -0,0 +1,45 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "commands.h"
+#include "ecs.h"
+
+// Runs the registered systems once per runSystems call. Each system declares the component types it
+// reads and writes, a system waits for every earlier registered system it conflicts with (one writes
+// what the other reads or writes) and everything else runs in parallel on the scheduler's thread pool.
+// Systems record structural changes in their command buffer instead of making them directly,
+// runSystems applies the buffers in registration order once every system is done. Only the system's
+// own thread may record, not parallelFor ranges. Systems making direct changes must be SYSTEM_EXCLUSIVE.
+
+#define SCHEDULER_MAX_SYSTEMS 32
+
+#define SYSTEM_NONE 0
+// Runs on the thread that calls runSystems, for OpenGL and GLFW calls
+#define SYSTEM_MAIN_THREAD 1
+// Runs alone, after every earlier system and before every later one
+#define SYSTEM_EXCLUSIVE 2
+
+typedef struct Scheduler Scheduler;
+
+typedef void(*SystemFunc)(ECS* ecs, Scheduler* scheduler, CommandBuffer* commands, void* context);
+typedef void(*ParallelForFunc)(unsigned int begin, unsigned int end, void* arg);
+// span is a QueryIterator positioned on one span, see queryNext
+typedef void(*QuerySpanFunc)(const QueryIterator* span, void* arg);
+
+// num_threads 0 uses one worker per CPU, 1 runs everything on the calling thread in registration order
+Scheduler* createScheduler(ECS* ecs, int num_threads);
+void destroyScheduler(Scheduler* scheduler);
+
+// Returns the system's index, -1 when SCHEDULER_MAX_SYSTEMS are registered
+int addSystem(Scheduler* scheduler, const char* name, SystemFunc func, void* context,
+	ComponentMask reads, ComponentMask writes, unsigned int flags);
+void runSystems(Scheduler* scheduler);
+
+// Calls func on [begin, end) ranges of up to grain items covering [0, count) from the pool's workers
+// and the calling thread, returns once all ranges are done. Safe to call from inside a system. A NULL
+// scheduler runs everything on the calling thread, for systems called directly.
+void parallelFor(Scheduler* scheduler, unsigned int count, unsigned int grain, ParallelForFunc func, void* arg);
+// Drains a query started with queryBegin or queryBeginChanged and hands its spans to func in parallel
+void parallelQuery(Scheduler* scheduler, QueryIterator* query, QuerySpanFunc func, void* arg);
+
+#endif
@@ -0,0 +1,155 @@
+#include <string.h>
+
+#include "sim.h"
+
+static bool piece_fits(const Board *board, int shape, int rotation, int row, int col) {
+	return !board_piece_overlaps(board, tetromino_defs[shape].masks[rotation], row, col);
+}
+
+void sim_piece_cells(const ActivePiece *piece, int cells[PIECE_CELLS][2]) {
+	const int8_t (*offsets)[2] = tetromino_defs[piece->shape].cells[piece->rotation];
+
+	for (int i = 0; i < PIECE_CELLS; i++) {
+		cells[i][0] = piece->row + offsets[i][0];
+		cells[i][1] = piece->col + offsets[i][1];
+	}
+}
+
+int sim_landing_row(const SimState *state) {
+	const ActivePiece *piece = &state->piece;
+	return board_landing_row(&state->board, tetromino_defs[piece->shape].masks[piece->rotation], piece->row, piece->col);
+}
+
+static bool spawn_piece(SimState *state, TetrominoShape shape) {
+	state->piece.shape = (uint8_t)shape;
+	state->piece.rotation = 0;
+	state->piece.row = (int8_t)tetromino_defs[shape].spawnRow;
+	state->piece.col = (int8_t)tetromino_defs[shape].spawnCol;
+
+	return piece_fits(&state->board, shape, 0, state->piece.row, state->piece.col);
+}
+
+static bool try_move(SimState *state, int d_row, int d_col) {
+	ActivePiece *piece = &state->piece;
+
+	if (!piece_fits(&state->board, piece->shape, piece->rotation, piece->row + d_row, piece->col + d_col)) {
+		return 0;
+	}
+
+	piece->row += d_row;
+	piece->col += d_col;
+	return 1;
+}
+
+static bool try_rotate(SimState *state) {
+	ActivePiece *piece = &state->piece;
+	const TetrominoDef *def = &tetromino_defs[piece->shape];
+	const int8_t (*kicks)[2] = def->kicks[piece->rotation];
+	int rotation = (piece->rotation + 1) % TETROMINO_ROTATIONS;
+
+	for (int k = 0; k < def->numKicks; k++) {
+		int row = piece->row + kicks[k][0];
+		int col = piece->col + kicks[k][1];
+
+		if (piece_fits(&state->board, piece->shape, rotation, row, col)) {
+			piece->rotation = (uint8_t)rotation;
+			piece->row = (int8_t)row;
+			piece->col = (int8_t)col;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void lock_piece(SimState *state, SimStepResult *result) {
+	ActivePiece *piece = &state->piece;
+
+	board_place_piece(&state->board, tetromino_defs[piece->shape].masks[piece->rotation], piece->row, piece->col);
+	sim_piece_cells(piece, result->lockedCells);
+	result->events |= SIM_EVENT_LOCKED;
+	state->pieces++;
+
+	result->numClearedRows = board_clear_full_rows(&state->board, result->clearedRows, PIECE_CELLS);
+
+	if (result->numClearedRows > 0) {
+		result->events |= SIM_EVENT_ROWS_CLEARED;
+		state->lines += result->numClearedRows;
+
+		if (board_is_empty(&state->board)) {
+			result->events |= SIM_EVENT_PERFECT_CLEAR;
+		}
+	}
+
+	if (spawn_piece(state, bag_next(&state->bag, &state->rng))) {
+		result->events |= SIM_EVENT_SPAWNED;
+	}
+	else {
+		state->gameOver = 1;
+		result->events |= SIM_EVENT_GAME_OVER;
+	}
+}
+
+void sim_init(SimState *state, uint64_t seed) {
+	board_init(&state->board);
+	rng_seed(&state->rng, seed);
+	bag_init(&state->bag, &state->rng);
+	state->pieces = 0;
+	state->lines = 0;
+	state->gameOver = 0;
+
+	if (!spawn_piece(state, bag_next(&state->bag, &state->rng))) {
+		state->gameOver = 1;
+	}
+}
+
+SimStepResult sim_step(SimState *state, SimInput input) {
+	SimStepResult result;
+	result.events = SIM_EVENT_NONE;
+	result.numClearedRows = 0;
+
+	if (state->gameOver) {
+		result.events |= SIM_EVENT_GAME_OVER;
+		return result;
+	}
+
+	switch (input) {
+	case SIM_INPUT_LEFT:
+		if (try_move(state, 0, -1)) {
+			result.events |= SIM_EVENT_MOVED;
+		}
+		break;
+	case SIM_INPUT_RIGHT:
+		if (try_move(state, 0, 1)) {
+			result.events |= SIM_EVENT_MOVED;
+		}
+		break;
+	case SIM_INPUT_DOWN:
+		if (try_move(state, 1, 0)) {
+			result.events |= SIM_EVENT_MOVED;
+		}
+		else {
+			lock_piece(state, &result);
+		}
+		break;
+	case SIM_INPUT_ROTATE:
+		if (try_rotate(state)) {
+			result.events |= SIM_EVENT_MOVED;
+		}
+		break;
+	case SIM_INPUT_HARD_DROP: {
+		int landing_row = sim_landing_row(state);
+		if (landing_row != state->piece.row) {
+			state->piece.row = (int8_t)landing_row;
+			result.events |= SIM_EVENT_MOVED;
+		}
+		lock_piece(state, &result);
+		break;
+	}
+	case SIM_INPUT_NONE:
+	default:
+		break;
+	}
+
+	return result;
+}
\ No newline at end of file
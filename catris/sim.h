@@ -0,0 +1,64 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+
+#include "bag.h"
+#include "board.h"
+#include "rng.h"
+#include "tetromino.h"
+
+// Game rules only, no GLFW/OpenGL so it can run headless
+
+typedef enum {
+	SIM_INPUT_NONE,
+	SIM_INPUT_LEFT,
+	SIM_INPUT_RIGHT,
+	SIM_INPUT_DOWN,
+	SIM_INPUT_ROTATE,
+	SIM_INPUT_HARD_DROP
+} SimInput;
+
+// Step event bitmasks
+#define SIM_EVENT_NONE          0
+#define SIM_EVENT_MOVED         1
+#define SIM_EVENT_LOCKED        2
+#define SIM_EVENT_ROWS_CLEARED  4
+#define SIM_EVENT_SPAWNED       8
+#define SIM_EVENT_GAME_OVER     16
+#define SIM_EVENT_PERFECT_CLEAR 32
+
+// The falling piece, its cells and row masks come from tetromino_defs
+typedef struct {
+	uint8_t shape;
+	uint8_t rotation; // quarter turns clockwise
+	int8_t row, col; // top left corner of the piece box on the board
+} ActivePiece;
+
+typedef struct {
+	unsigned int events;
+	// Removed rows, bottom row first, indices are from before the board was compacted
+	int numClearedRows;
+	int clearedRows[PIECE_CELLS];
+	// Cells of the piece that locked during this step
+	int lockedCells[PIECE_CELLS][2];
+} SimStepResult;
+
+typedef struct {
+	Board board;
+	ActivePiece piece;
+	// Each game owns its generator so the same seed always gives the same pieces
+	Rng rng;
+	PieceBag bag;
+	unsigned int pieces;
+	unsigned int lines;
+	bool gameOver;
+} SimState;
+
+void sim_init(SimState *state, uint64_t seed);
+SimStepResult sim_step(SimState *state, SimInput input);
+void sim_piece_cells(const ActivePiece *piece, int cells[PIECE_CELLS][2]);
+// Row the active piece would lock on, for hard drops and the ghost piece
+int sim_landing_row(const SimState *state);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "snapshot.h"
+
+static size_t snapshot_align(size_t size) {
+	return (size + 15) & ~(size_t)15;
+}
+
+int snapshot_save(const char *path, const SimState *state, const ECS *ecs, const void *user_data, size_t user_size) {
+	SnapshotHeader header;
+	size_t ecs_size = ecs != NULL ? getECSSnapshotSize(ecs) : 0;
+	FILE *file;
+	char *data;
+	int ok;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.stateSize = (uint16_t)sizeof(SimState);
+	header.stateOffset = (uint32_t)snapshot_align(sizeof(SnapshotHeader));
+	header.ecsOffset = (uint32_t)snapshot_align(header.stateOffset + sizeof(SimState));
+	header.ecsSize = (uint32_t)ecs_size;
+	header.userOffset = (uint32_t)snapshot_align(header.ecsOffset + ecs_size);
+	header.userSize = user_data != NULL ? (uint32_t)user_size : 0;
+
+	// Built in memory and written at once, the padding between sections is zeroed
+	size_t size = header.userOffset + header.userSize;
+	data = calloc(1, size);
+	if (data == NULL) {
+		printf("Error: Out of memory saving snapshot %s\n", path);
+		return 0;
+	}
+
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + header.stateOffset, state, sizeof(SimState));
+	if (ecs != NULL) {
+		writeECSSnapshot(ecs, data + header.ecsOffset);
+	}
+	if (header.userSize > 0) {
+		memcpy(data + header.userOffset, user_data, header.userSize);
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		printf("Error: Could not open %s for writing\n", path);
+		free(data);
+		return 0;
+	}
+
+	ok = fwrite(data, size, 1, file) == 1;
+	ok = fclose(file) == 0 && ok;
+	free(data);
+
+	if (!ok) {
+		printf("Error: Could not write snapshot to %s\n", path);
+	}
+	return ok;
+}
+
+static int snapshot_is_valid(const void *data, size_t size) {
+	const SnapshotHeader *header = data;
+
+	if (size < sizeof(SnapshotHeader) || header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION
+		|| header->stateSize != sizeof(SimState)) {
+		return 0;
+	}
+
+	return header->stateOffset >= sizeof(SnapshotHeader) && size >= (size_t)header->stateOffset + sizeof(SimState)
+		&& header->ecsOffset % 16 == 0 && size >= (size_t)header->ecsOffset + header->ecsSize
+		&& size >= (size_t)header->userOffset + header->userSize;
+}
+
+int snapshot_open(Snapshot *snapshot, const char *path) {
+	memset(snapshot, 0, sizeof(Snapshot));
+	snapshot->data = platform_map_file(path, &snapshot->size);
+	if (snapshot->data == NULL) {
+		printf("Error: Could not map snapshot %s\n", path);
+		return 0;
+	}
+
+	if (!snapshot_is_valid(snapshot->data, snapshot->size)) {
+		printf("Error: %s is not a valid snapshot\n", path);
+		snapshot_close(snapshot);
+		return 0;
+	}
+
+	snapshot->header = snapshot->data;
+	snapshot->userData = (const char *)snapshot->data + snapshot->header->userOffset;
+	return 1;
+}
+
+void snapshot_close(Snapshot *snapshot) {
+	if (snapshot->data != NULL) {
+		platform_unmap_file(snapshot->data, snapshot->size);
+	}
+	memset(snapshot, 0, sizeof(Snapshot));
+}
+
+void snapshot_state(const Snapshot *snapshot, SimState *state) {
+	memcpy(state, (const char *)snapshot->data + snapshot->header->stateOffset, sizeof(SimState));
+}
+
+int snapshot_restore_ecs(const Snapshot *snapshot, ECS *ecs) {
+	if (snapshot->header->ecsSize == 0) {
+		printf("Error: Snapshot has no ECS to restore\n");
+		return 0;
+	}
+	return readECSSnapshot(ecs, (const char *)snapshot->data + snapshot->header->ecsOffset, snapshot->header->ecsSize);
+}
@@ -0,0 +1,48 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ecs.h"
+#include "sim.h"
+
+// Save states: the sim state, an image of the ECS (see writeECSSnapshot) and a blob of caller data
+// in one file, read back in place from a memory map. Restoring is a few memcpys, cheap enough to
+// start every training game from the same position.
+// File layout: SnapshotHeader, SimState, ECS image, user data, each starting 16 byte aligned.
+// The SimState is stored as is, so a snapshot only loads into a build with the same board size.
+
+#define SNAPSHOT_MAGIC 0x53535443 // "CTSS"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t stateSize; // sizeof(SimState)
+	uint32_t stateOffset;
+	uint32_t ecsOffset;
+	uint32_t ecsSize; // 0 when saved without an ECS
+	uint32_t userOffset;
+	uint32_t userSize;
+	uint32_t padding;
+} SnapshotHeader;
+
+typedef struct {
+	const void *data;
+	size_t size;
+	const SnapshotHeader *header;
+	const void *userData; // header->userSize bytes
+} Snapshot;
+
+// ecs and user_data may be NULL
+int snapshot_save(const char *path, const SimState *state, const ECS *ecs, const void *user_data, size_t user_size);
+
+// Returns 0 if the file can't be mapped or isn't a valid snapshot
+int snapshot_open(Snapshot *snapshot, const char *path);
+void snapshot_close(Snapshot *snapshot);
+void snapshot_state(const Snapshot *snapshot, SimState *state);
+// Replaces the contents of ecs, returns 0 if the snapshot has no ECS image or it doesn't fit this build
+int snapshot_restore_ecs(const Snapshot *snapshot, ECS *ecs);
+
+#endif
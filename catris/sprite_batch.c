@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glad/glad.h>
+
+#include "app_context.h"
+#include "opengl.h"
+#include "sprite_batch.h"
+
+#define SPRITE_QUAD_VERTICES 4
+#define SPRITE_QUAD_INDICES 6
+
+void initSpriteBatch(SpriteBatch* batch, unsigned int program) {
+	memset(batch, 0, sizeof(SpriteBatch));
+	batch->vertices = malloc(SPRITE_BATCH_CAPACITY * SPRITE_QUAD_VERTICES * VERTEX_SIZE * sizeof(float));
+	batch->indices = malloc(SPRITE_BATCH_CAPACITY * SPRITE_QUAD_INDICES * sizeof(unsigned int));
+	batch->alphaLocation = glGetUniformLocation(program, "alpha");
+
+	glGenVertexArrays(1, &batch->VAO);
+	glGenBuffers(1, &batch->VBO);
+	glGenBuffers(1, &batch->VEO);
+
+	// Storage is allocated once, every flush orphans it and streams the quads in
+	glBindVertexArray(batch->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, batch->VBO);
+	glBufferData(GL_ARRAY_BUFFER, SPRITE_BATCH_CAPACITY * SPRITE_QUAD_VERTICES * VERTEX_SIZE * sizeof(float), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->VEO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, SPRITE_BATCH_CAPACITY * SPRITE_QUAD_INDICES * sizeof(unsigned int), NULL, GL_STREAM_DRAW);
+
+	setupVertexAttrib(POSITION_ATTRIBUTE, POSITION_SIZE, VERTEX_SIZE, (void*)0);
+	setupVertexAttrib(COLOR_ATTRIBUTE, COLOR_SIZE, VERTEX_SIZE, (void*)(POSITION_SIZE * sizeof(float)));
+	setupVertexAttrib(TEXTURE_COORD_ATTRIBUTE, TEXTURE_COORD_SIZE, VERTEX_SIZE, (void*)((POSITION_SIZE + COLOR_SIZE) * sizeof(float)));
+
+	glBindVertexArray(0);
+}
+
+void freeSpriteBatch(SpriteBatch* batch) {
+	glDeleteVertexArrays(1, &batch->VAO);
+	glDeleteBuffers(1, &batch->VBO);
+	glDeleteBuffers(1, &batch->VEO);
+	free(batch->vertices);
+	free(batch->indices);
+	memset(batch, 0, sizeof(SpriteBatch));
+}
+
+void beginSpriteBatch(SpriteBatch* batch, unsigned int program) {
+	mat4 identity;
+
+	glm_mat4_identity(identity);
+	glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, (float*)identity);
+	batch->numQuads = 0;
+	batch->drawCalls = 0;
+}
+
+void flushSpriteBatch(SpriteBatch* batch) {
+	if (batch->numQuads == 0) {
+		return;
+	}
+
+	glBindVertexArray(batch->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, batch->VBO);
+	glBufferData(GL_ARRAY_BUFFER, SPRITE_BATCH_CAPACITY * SPRITE_QUAD_VERTICES * VERTEX_SIZE * sizeof(float), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, batch->numQuads * SPRITE_QUAD_VERTICES * VERTEX_SIZE * sizeof(float), batch->vertices);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, SPRITE_BATCH_CAPACITY * SPRITE_QUAD_INDICES * sizeof(unsigned int), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, batch->numQuads * SPRITE_QUAD_INDICES * sizeof(unsigned int), batch->indices);
+
+	opengl_set_current_texture(batch->texture);
+	glUniform1f(batch->alphaLocation, batch->alpha);
+	glDrawElements(GL_TRIANGLES, batch->numQuads * SPRITE_QUAD_INDICES, GL_UNSIGNED_INT, 0);
+	glBindVertexArray(0);
+
+	batch->numQuads = 0;
+	batch->drawCalls++;
+}
+
+void addSpriteToBatch(SpriteBatch* batch, const VertexComponent* vertex, const mat4 model, unsigned int texture, float alpha) {
+	if (batch->numQuads > 0 && (texture != batch->texture || alpha != batch->alpha || batch->numQuads == SPRITE_BATCH_CAPACITY)) {
+		flushSpriteBatch(batch);
+	}
+	batch->texture = texture;
+	batch->alpha = alpha;
+
+	// Positions go to world space here, colors and texture coordinates are copied as they are
+	float* out = batch->vertices + batch->numQuads * SPRITE_QUAD_VERTICES * VERTEX_SIZE;
+	for (int i = 0; i < SPRITE_QUAD_VERTICES; i++) {
+		const float* in = vertex->vertices + i * VERTEX_SIZE;
+		vec3 position;
+
+		glm_mat4_mulv3((vec4*)model, (float*)in, 1.0f, position);
+		memcpy(out, position, sizeof(position));
+		memcpy(out + POSITION_SIZE, in + POSITION_SIZE, (VERTEX_SIZE - POSITION_SIZE) * sizeof(float));
+		out += VERTEX_SIZE;
+	}
+
+	unsigned int base = batch->numQuads * SPRITE_QUAD_VERTICES;
+	unsigned int* indices = batch->indices + batch->numQuads * SPRITE_QUAD_INDICES;
+	for (int i = 0; i < SPRITE_QUAD_INDICES; i++) {
+		indices[i] = base + vertex->indices[i];
+	}
+	batch->numQuads++;
+}
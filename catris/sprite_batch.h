@@ -0,0 +1,33 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "ecs.h"
+
+// Collects sprite quads, already transformed by their model, into one streaming vertex and index
+// buffer and draws them with as few calls as possible. Quads are drawn in the order they're added,
+// consecutive ones with the same texture and alpha share a draw call.
+#define SPRITE_BATCH_CAPACITY 1024 // quads per draw call, a full batch is drawn early
+
+typedef struct {
+	unsigned int VAO;
+	unsigned int VBO;
+	unsigned int VEO;
+	float *vertices;
+	unsigned int *indices;
+	unsigned int numQuads;
+	unsigned int texture;
+	float alpha;
+	int alphaLocation;
+	unsigned int drawCalls; // since the last beginSpriteBatch
+} SpriteBatch;
+
+void initSpriteBatch(SpriteBatch* batch, unsigned int program);
+void freeSpriteBatch(SpriteBatch* batch);
+
+// The program must be in use with its projection set, the model uniform is set to the identity
+void beginSpriteBatch(SpriteBatch* batch, unsigned int program);
+void addSpriteToBatch(SpriteBatch* batch, const VertexComponent* vertex, const mat4 model, unsigned int texture, float alpha);
+// Draws what's left, call it at the end of the frame's sprites
+void flushSpriteBatch(SpriteBatch* batch);
+
+#endif
@@ -0,0 +1,136 @@
+#include "tetromino.h"
+
+// SRS wall kicks, converted to (row, col) with rows growing downwards
+static const int8_t jlstz_kicks[TETROMINO_ROTATIONS][TETROMINO_KICKS][2] = {
+	{ { 0, 0 }, { 0, -1 }, { -1, -1 }, { 2, 0 }, { 2, -1 } },  // 0 -> R
+	{ { 0, 0 }, { 0, 1 }, { 1, 1 }, { -2, 0 }, { -2, 1 } },    // R -> 2
+	{ { 0, 0 }, { 0, 1 }, { -1, 1 }, { 2, 0 }, { 2, 1 } },     // 2 -> L
+	{ { 0, 0 }, { 0, -1 }, { 1, -1 }, { -2, 0 }, { -2, -1 } }  // L -> 0
+};
+
+static const int8_t i_kicks[TETROMINO_ROTATIONS][TETROMINO_KICKS][2] = {
+	{ { 0, 0 }, { 0, -2 }, { 0, 1 }, { 1, -2 }, { -2, 1 } },   // 0 -> R
+	{ { 0, 0 }, { 0, -1 }, { 0, 2 }, { -2, -1 }, { 1, 2 } },   // R -> 2
+	{ { 0, 0 }, { 0, 2 }, { 0, -1 }, { -1, 2 }, { 2, -1 } },   // 2 -> L
+	{ { 0, 0 }, { 0, 1 }, { 0, -2 }, { 2, 1 }, { -1, -2 } }    // L -> 0
+};
+
+static const int8_t o_kicks[TETROMINO_ROTATIONS][TETROMINO_KICKS][2] = { { { 0, 0 } }, { { 0, 0 } }, { { 0, 0 } }, { { 0, 0 } } };
+
+// Cells keep their order through every rotation so the head tile follows the piece,
+// the masks hold the same cells as one bit per box column for each box row.
+// S and Z keep the geometry and atlas rows the game has always drawn them with.
+const TetrominoDef tetromino_defs[TETROMINO_COUNT] = {
+	// I
+	{
+		{
+			{ { 1, 0 }, { 1, 1 }, { 1, 2 }, { 1, 3 } },
+			{ { 0, 2 }, { 1, 2 }, { 2, 2 }, { 3, 2 } },
+			{ { 2, 3 }, { 2, 2 }, { 2, 1 }, { 2, 0 } },
+			{ { 3, 1 }, { 2, 1 }, { 1, 1 }, { 0, 1 } }
+		},
+		{
+			{ 0x0, 0xF, 0x0, 0x0 },
+			{ 0x4, 0x4, 0x4, 0x4 },
+			{ 0x0, 0x0, 0xF, 0x0 },
+			{ 0x2, 0x2, 0x2, 0x2 }
+		},
+		i_kicks, TETROMINO_KICKS, 0, -1, 7
+	},
+	// O
+	{
+		{
+			{ { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 } },
+			{ { 0, 1 }, { 1, 1 }, { 0, 0 }, { 1, 0 } },
+			{ { 1, 1 }, { 1, 0 }, { 0, 1 }, { 0, 0 } },
+			{ { 1, 0 }, { 0, 0 }, { 1, 1 }, { 0, 1 } }
+		},
+		{
+			{ 0x3, 0x3, 0x0, 0x0 },
+			{ 0x3, 0x3, 0x0, 0x0 },
+			{ 0x3, 0x3, 0x0, 0x0 },
+			{ 0x3, 0x3, 0x0, 0x0 }
+		},
+		o_kicks, 1, 64, 0, 7
+	},
+	// T
+	{
+		{
+			{ { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, 2 } },
+			{ { 1, 2 }, { 0, 1 }, { 1, 1 }, { 2, 1 } },
+			{ { 2, 1 }, { 1, 2 }, { 1, 1 }, { 1, 0 } },
+			{ { 1, 0 }, { 2, 1 }, { 1, 1 }, { 0, 1 } }
+		},
+		{
+			{ 0x2, 0x7, 0x0, 0x0 },
+			{ 0x2, 0x6, 0x2, 0x0 },
+			{ 0x0, 0x7, 0x2, 0x0 },
+			{ 0x2, 0x3, 0x2, 0x0 }
+		},
+		jlstz_kicks, TETROMINO_KICKS, 128, 0, 7
+	},
+	// J
+	{
+		{
+			{ { 0, 0 }, { 1, 0 }, { 1, 1 }, { 1, 2 } },
+			{ { 0, 2 }, { 0, 1 }, { 1, 1 }, { 2, 1 } },
+			{ { 2, 2 }, { 1, 2 }, { 1, 1 }, { 1, 0 } },
+			{ { 2, 0 }, { 2, 1 }, { 1, 1 }, { 0, 1 } }
+		},
+		{
+			{ 0x1, 0x7, 0x0, 0x0 },
+			{ 0x6, 0x2, 0x2, 0x0 },
+			{ 0x0, 0x7, 0x4, 0x0 },
+			{ 0x2, 0x2, 0x3, 0x0 }
+		},
+		jlstz_kicks, TETROMINO_KICKS, 192, 0, 7
+	},
+	// L
+	{
+		{
+			{ { 0, 2 }, { 1, 0 }, { 1, 1 }, { 1, 2 } },
+			{ { 2, 2 }, { 0, 1 }, { 1, 1 }, { 2, 1 } },
+			{ { 2, 0 }, { 1, 2 }, { 1, 1 }, { 1, 0 } },
+			{ { 0, 0 }, { 2, 1 }, { 1, 1 }, { 0, 1 } }
+		},
+		{
+			{ 0x4, 0x7, 0x0, 0x0 },
+			{ 0x2, 0x2, 0x6, 0x0 },
+			{ 0x0, 0x7, 0x1, 0x0 },
+			{ 0x3, 0x2, 0x2, 0x0 }
+		},
+		jlstz_kicks, TETROMINO_KICKS, 256, 0, 7
+	},
+	// S
+	{
+		{
+			{ { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 2 } },
+			{ { 0, 2 }, { 1, 2 }, { 1, 1 }, { 2, 1 } },
+			{ { 2, 2 }, { 2, 1 }, { 1, 1 }, { 1, 0 } },
+			{ { 2, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }
+		},
+		{
+			{ 0x3, 0x6, 0x0, 0x0 },
+			{ 0x4, 0x6, 0x2, 0x0 },
+			{ 0x0, 0x3, 0x6, 0x0 },
+			{ 0x2, 0x3, 0x1, 0x0 }
+		},
+		jlstz_kicks, TETROMINO_KICKS, 384, 0, 7
+	},
+	// Z
+	{
+		{
+			{ { 0, 1 }, { 0, 2 }, { 1, 0 }, { 1, 1 } },
+			{ { 1, 2 }, { 2, 2 }, { 0, 1 }, { 1, 1 } },
+			{ { 2, 1 }, { 2, 0 }, { 1, 2 }, { 1, 1 } },
+			{ { 1, 0 }, { 0, 0 }, { 2, 1 }, { 1, 1 } }
+		},
+		{
+			{ 0x6, 0x3, 0x0, 0x0 },
+			{ 0x2, 0x6, 0x4, 0x0 },
+			{ 0x0, 0x6, 0x3, 0x0 },
+			{ 0x1, 0x3, 0x2, 0x0 }
+		},
+		jlstz_kicks, TETROMINO_KICKS, 320, 0, 7
+	}
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef TETROMINO_H
+#define TETROMINO_H
+
+#include <stdint.h>
+
+#include "board.h"
+
+typedef enum {
+	TETROMINO_I,
+	TETROMINO_O,
+	TETROMINO_T,
+	TETROMINO_J,
+	TETROMINO_L,
+	TETROMINO_S,
+	TETROMINO_Z
+} TetrominoShape;
+
+#define TETROMINO_COUNT 7
+#define TETROMINO_ROTATIONS 4
+#define TETROMINO_KICKS 5
+#define PIECE_CELLS 4
+
+// Atlas region of a piece: every shape has a row of tiles, the first cell uses the head tile
+#define TETROMINO_ATLAS_TILE_SIZE 64
+#define TETROMINO_ATLAS_HEAD_X 0
+#define TETROMINO_ATLAS_BODY_X 64
+
+typedef struct {
+	// Cells per rotation (quarter turns clockwise), row and col inside the piece box
+	int8_t cells[TETROMINO_ROTATIONS][PIECE_CELLS][2];
+	// The same cells as row masks of the piece box, bit N is box column N
+	BoardRow masks[TETROMINO_ROTATIONS][BOARD_PIECE_ROWS];
+	// Offsets (row, col) tried in order when rotating clockwise out of each rotation
+	const int8_t (*kicks)[TETROMINO_KICKS][2];
+	int numKicks;
+	int atlasY;
+	// Top left corner of the piece box when spawned
+	int spawnRow;
+	int spawnCol;
+} TetrominoDef;
+
+extern const TetrominoDef tetromino_defs[TETROMINO_COUNT];
+
+#endif
\ No newline at end of file
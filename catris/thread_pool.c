@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread_pool.h"
+
+#define THREAD_POOL_QUEUE_CAPACITY 64
+
+static PLATFORM_THREAD_LOCAL int current_worker_index = -1;
+static PLATFORM_THREAD_LOCAL ThreadPool *current_worker_pool = NULL;
+
+static void queue_init(ThreadPoolQueue *queue) {
+	platform_mutex_init(&queue->lock);
+	queue->tasks = malloc(THREAD_POOL_QUEUE_CAPACITY * sizeof(ThreadPoolTask));
+	queue->head = 0;
+	queue->count = 0;
+	queue->capacity = THREAD_POOL_QUEUE_CAPACITY;
+}
+
+static void queue_free(ThreadPoolQueue *queue) {
+	platform_mutex_destroy(&queue->lock);
+	free(queue->tasks);
+	queue->tasks = NULL;
+}
+
+static void queue_push(ThreadPoolQueue *queue, ThreadPoolTask task) {
+	platform_mutex_lock(&queue->lock);
+
+	if (queue->count == queue->capacity) {
+		ThreadPoolTask *tasks = malloc(queue->capacity * 2 * sizeof(ThreadPoolTask));
+		for (int i = 0; i < queue->count; i++) {
+			tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+		}
+		free(queue->tasks);
+		queue->tasks = tasks;
+		queue->head = 0;
+		queue->capacity *= 2;
+	}
+
+	queue->tasks[(queue->head + queue->count) % queue->capacity] = task;
+	queue->count++;
+
+	platform_mutex_unlock(&queue->lock);
+}
+
+// The owner takes the newest task
+static int queue_pop_back(ThreadPoolQueue *queue, ThreadPoolTask *task) {
+	int found = 0;
+	platform_mutex_lock(&queue->lock);
+
+	if (queue->count > 0) {
+		queue->count--;
+		*task = queue->tasks[(queue->head + queue->count) % queue->capacity];
+		found = 1;
+	}
+
+	platform_mutex_unlock(&queue->lock);
+	return found;
+}
+
+// Thieves take the oldest task
+static int queue_pop_front(ThreadPoolQueue *queue, ThreadPoolTask *task) {
+	int found = 0;
+	platform_mutex_lock(&queue->lock);
+
+	if (queue->count > 0) {
+		*task = queue->tasks[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		queue->count--;
+		found = 1;
+	}
+
+	platform_mutex_unlock(&queue->lock);
+	return found;
+}
+
+static int find_task(ThreadPool *pool, int index, ThreadPoolTask *task, int *stolen) {
+	if (queue_pop_back(&pool->queues[index], task)) {
+		*stolen = 0;
+		return 1;
+	}
+
+	for (int i = 1; i < pool->numThreads; i++) {
+		int victim = (index + i) % pool->numThreads;
+		if (queue_pop_front(&pool->queues[victim], task)) {
+			*stolen = 1;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void worker_main(void *arg) {
+	ThreadPoolWorker *worker = arg;
+	ThreadPool *pool = worker->pool;
+	ThreadPoolWorkerStats *stats = &pool->stats[worker->index];
+
+	current_worker_index = worker->index;
+	current_worker_pool = pool;
+
+	for (;;) {
+		ThreadPoolTask task;
+		int stolen;
+
+		if (find_task(pool, worker->index, &task, &stolen)) {
+			platform_atomic_add(&pool->queued, -1);
+
+			double start = platform_time_seconds();
+			task.func(task.arg);
+			stats->busySeconds += platform_time_seconds() - start;
+			stats->tasksRun++;
+			stats->tasksStolen += stolen;
+
+			if (platform_atomic_add(&pool->pending, -1) == 0) {
+				platform_mutex_lock(&pool->wakeLock);
+				platform_cond_broadcast(&pool->doneCond);
+				platform_mutex_unlock(&pool->wakeLock);
+			}
+			continue;
+		}
+
+		platform_mutex_lock(&pool->wakeLock);
+		while (platform_atomic_load(&pool->queued) == 0 && !pool->stop) {
+			platform_cond_wait(&pool->wakeCond, &pool->wakeLock);
+		}
+		int stop = pool->stop && platform_atomic_load(&pool->queued) == 0;
+		platform_mutex_unlock(&pool->wakeLock);
+
+		if (stop) {
+			break;
+		}
+	}
+}
+
+ThreadPool *thread_pool_create(int num_threads) {
+	ThreadPool *pool = malloc(sizeof(ThreadPool));
+
+	if (num_threads <= 0) {
+		num_threads = platform_cpu_count();
+	}
+
+	pool->numThreads = num_threads;
+	pool->threads = malloc(num_threads * sizeof(PlatformThread));
+	pool->workers = malloc(num_threads * sizeof(ThreadPoolWorker));
+	pool->queues = malloc(num_threads * sizeof(ThreadPoolQueue));
+	pool->stats = platform_aligned_calloc(PLATFORM_CACHE_LINE, num_threads * sizeof(ThreadPoolWorkerStats));
+	pool->queued = 0;
+	pool->pending = 0;
+	pool->nextQueue = 0;
+	pool->stop = 0;
+	platform_mutex_init(&pool->wakeLock);
+	platform_cond_init(&pool->wakeCond);
+	platform_cond_init(&pool->doneCond);
+
+	for (int i = 0; i < num_threads; i++) {
+		queue_init(&pool->queues[i]);
+	}
+
+	for (int i = 0; i < num_threads; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		platform_thread_create(&pool->threads[i], worker_main, &pool->workers[i]);
+	}
+
+	return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+	thread_pool_wait(pool);
+
+	platform_mutex_lock(&pool->wakeLock);
+	pool->stop = 1;
+	platform_cond_broadcast(&pool->wakeCond);
+	platform_mutex_unlock(&pool->wakeLock);
+
+	// Running workers still steal from every queue, only free them once all have exited
+	for (int i = 0; i < pool->numThreads; i++) {
+		platform_thread_join(pool->threads[i]);
+	}
+	for (int i = 0; i < pool->numThreads; i++) {
+		queue_free(&pool->queues[i]);
+	}
+
+	platform_cond_destroy(&pool->doneCond);
+	platform_cond_destroy(&pool->wakeCond);
+	platform_mutex_destroy(&pool->wakeLock);
+	platform_aligned_free(pool->stats);
+	free(pool->queues);
+	free(pool->workers);
+	free(pool->threads);
+	free(pool);
+}
+
+void thread_pool_submit(ThreadPool *pool, ThreadPoolTaskFunc func, void *arg) {
+	ThreadPoolTask task;
+	int index;
+
+	task.func = func;
+	task.arg = arg;
+
+	// Workers keep their own tasks local, everyone else spreads them round robin
+	if (current_worker_pool == pool) {
+		index = current_worker_index;
+	}
+	else {
+		index = (int)((unsigned long)platform_atomic_add(&pool->nextQueue, 1) % (unsigned long)pool->numThreads);
+	}
+
+	platform_atomic_add(&pool->pending, 1);
+	queue_push(&pool->queues[index], task);
+	platform_atomic_add(&pool->queued, 1);
+
+	platform_mutex_lock(&pool->wakeLock);
+	platform_cond_broadcast(&pool->wakeCond);
+	platform_mutex_unlock(&pool->wakeLock);
+}
+
+void thread_pool_wait(ThreadPool *pool) {
+	platform_mutex_lock(&pool->wakeLock);
+	while (platform_atomic_load(&pool->pending) != 0) {
+		platform_cond_wait(&pool->doneCond, &pool->wakeLock);
+	}
+	platform_mutex_unlock(&pool->wakeLock);
+}
+
+int thread_pool_worker_index(void) {
+	return current_worker_index;
+}
+
+void thread_pool_reset_stats(ThreadPool *pool) {
+	memset(pool->stats, 0, pool->numThreads * sizeof(ThreadPoolWorkerStats));
+}
\ No newline at end of file
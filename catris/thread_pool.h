@@ -0,0 +1,61 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "platform.h"
+
+// Work-stealing pool: every worker owns a deque, runs its own tasks newest first
+// and steals the oldest task of another worker when it runs dry.
+
+typedef void(*ThreadPoolTaskFunc)(void *arg);
+
+typedef struct {
+	ThreadPoolTaskFunc func;
+	void *arg;
+} ThreadPoolTask;
+
+typedef struct {
+	PlatformMutex lock;
+	ThreadPoolTask *tasks; // ring buffer
+	int head;
+	int count;
+	int capacity;
+} ThreadPoolQueue;
+
+typedef struct {
+	double busySeconds;
+	unsigned long long tasksRun;
+	unsigned long long tasksStolen;
+	char padding[PLATFORM_CACHE_LINE - sizeof(double) - 2 * sizeof(unsigned long long)]; // one cache line per worker
+} ThreadPoolWorkerStats;
+
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+	ThreadPool *pool;
+	int index;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+	int numThreads;
+	PlatformThread *threads;
+	ThreadPoolWorker *workers;
+	ThreadPoolQueue *queues;
+	ThreadPoolWorkerStats *stats; // one per worker, cache line aligned
+	volatile long queued;  // tasks sitting in a queue
+	volatile long pending; // tasks submitted and not finished yet
+	volatile long nextQueue;
+	volatile int stop;
+	PlatformMutex wakeLock;
+	PlatformCond wakeCond;
+	PlatformCond doneCond;
+};
+
+ThreadPool *thread_pool_create(int num_threads);
+void thread_pool_destroy(ThreadPool *pool);
+void thread_pool_submit(ThreadPool *pool, ThreadPoolTaskFunc func, void *arg);
+void thread_pool_wait(ThreadPool *pool);
+// Index of the calling worker, -1 when called from outside the pool
+int thread_pool_worker_index(void);
+void thread_pool_reset_stats(ThreadPool *pool);
+
+#endif
\ No newline at end of file
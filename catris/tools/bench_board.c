@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "platform.h"
+#include "rng.h"
+#include "sim.h"
+
+// Microbenchmarks for the board and piece hot paths at several board fill levels.
+// usage: bench_board [-n iterations] [-f name filter]
+// Mutating benchmarks copy a prepared board every iteration, compare them against "board copy".
+// Allocations are counted by wrapping malloc/calloc/realloc at link time (see the Makefile).
+
+#define BENCH_BOARDS 64
+#define BENCH_PIECES 256
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static unsigned long long allocations;
+
+void *__wrap_malloc(size_t size) {
+	allocations++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	allocations++;
+	return __real_realloc(ptr, size);
+}
+
+typedef struct {
+	int cell[2];
+	int shape;
+	int rotation;
+	int row;
+	int col;
+} PieceSample;
+
+typedef struct {
+	Board boards[BENCH_BOARDS];
+	SimState states[BENCH_BOARDS];
+	PieceSample pieces[BENCH_PIECES];
+	int topRow[BENCH_BOARDS]; // highest non empty row, GRID_ROWS if empty
+} BenchData;
+
+typedef unsigned long long (*BenchFunc)(BenchData *data, long iterations);
+
+static volatile unsigned long long sink;
+
+// Stacks fill percent of the rows from the bottom. Every stacked row has a few holes,
+// a quarter of them are full so the clear paths have work to do.
+static void make_board(Board *board, int *top_row, int fill, Rng *rng) {
+	int stacked = (GRID_ROWS * fill + 50) / 100;
+
+	board_init(board);
+	*top_row = GRID_ROWS - stacked;
+
+	for (int row = GRID_ROWS - stacked; row < GRID_ROWS; row++) {
+		for (int col = BOARD_FIRST_PLAYFIELD_COL; col <= BOARD_LAST_PLAYFIELD_COL; col++) {
+			board_set_cell(board, row, col, 1);
+		}
+		if (rng_range(rng, 4) != 0) {
+			int holes = 1 + (int)rng_range(rng, 3);
+			for (int i = 0; i < holes; i++) {
+				board_set_cell(board, row, BOARD_FIRST_PLAYFIELD_COL + (int)rng_range(rng, BOARD_LAST_PLAYFIELD_COL - BOARD_FIRST_PLAYFIELD_COL + 1), 0);
+			}
+		}
+	}
+}
+
+static void make_data(BenchData *data, int fill) {
+	Rng rng;
+	rng_seed(&rng, (uint64_t)fill);
+
+	for (int i = 0; i < BENCH_BOARDS; i++) {
+		make_board(&data->boards[i], &data->topRow[i], fill, &rng);
+		sim_init(&data->states[i], (uint64_t)i);
+		data->states[i].board = data->boards[i];
+	}
+
+	for (int i = 0; i < BENCH_PIECES; i++) {
+		PieceSample *piece = &data->pieces[i];
+		piece->cell[0] = (int)rng_range(&rng, GRID_ROWS);
+		piece->cell[1] = (int)rng_range(&rng, GRID_COLS);
+		piece->shape = (int)rng_range(&rng, TETROMINO_COUNT);
+		piece->rotation = (int)rng_range(&rng, TETROMINO_ROTATIONS);
+		piece->row = (int)rng_range(&rng, GRID_ROWS) - 1;
+		piece->col = (int)rng_range(&rng, GRID_COLS - 1) - 1;
+	}
+}
+
+static unsigned long long bench_board_copy(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		Board board = data->boards[i % BENCH_BOARDS];
+		sum += board.rows[GRID_ROWS - 1];
+	}
+	return sum;
+}
+
+static unsigned long long bench_highest_full_row(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		sum += board_find_highest_full_row(&data->boards[i % BENCH_BOARDS]);
+	}
+	return sum;
+}
+
+static unsigned long long bench_is_empty(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		sum += board_is_empty(&data->boards[i % BENCH_BOARDS]);
+	}
+	return sum;
+}
+
+static unsigned long long bench_clear_full_rows(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	int cleared[GRID_ROWS];
+	for (long i = 0; i < iterations; i++) {
+		Board board = data->boards[i % BENCH_BOARDS];
+		sum += board_clear_full_rows(&board, cleared, GRID_ROWS);
+		sum += board.rows[GRID_ROWS - 1];
+	}
+	return sum;
+}
+
+static unsigned long long bench_remove_row(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		Board board = data->boards[i % BENCH_BOARDS];
+		board_remove_row(&board, GRID_ROWS - 1);
+		sum += board.rows[GRID_ROWS - 1];
+	}
+	return sum;
+}
+
+static unsigned long long bench_get_cell(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		const PieceSample *sample = &data->pieces[i % BENCH_PIECES];
+		sum += board_get_cell(&data->boards[i % BENCH_BOARDS], sample->cell[0], sample->cell[1]);
+	}
+	return sum;
+}
+
+static unsigned long long bench_set_cell(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		const PieceSample *sample = &data->pieces[i % BENCH_PIECES];
+		Board *board = &data->boards[i % BENCH_BOARDS];
+		bool filled = board_get_cell(board, sample->cell[0], sample->cell[1]);
+		// Writes the value back so the boards keep their fill level
+		board_set_cell(board, sample->cell[0], sample->cell[1], filled);
+		sum += filled;
+	}
+	return sum;
+}
+
+static unsigned long long bench_piece_overlaps(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		const PieceSample *sample = &data->pieces[i % BENCH_PIECES];
+		sum += board_piece_overlaps(&data->boards[i % BENCH_BOARDS], tetromino_defs[sample->shape].masks[sample->rotation], sample->row, sample->col);
+	}
+	return sum;
+}
+
+static unsigned long long bench_landing_row(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		const SimState *state = &data->states[i % BENCH_BOARDS];
+		sum += sim_landing_row(state);
+	}
+	return sum;
+}
+
+static unsigned long long bench_sim_rotate(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		SimState *state = &data->states[i % BENCH_BOARDS];
+		sum += sim_step(state, SIM_INPUT_ROTATE).events;
+	}
+	return sum;
+}
+
+static unsigned long long bench_sim_shift(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		SimState *state = &data->states[i % BENCH_BOARDS];
+		sum += sim_step(state, (i / BENCH_BOARDS) & 1 ? SIM_INPUT_LEFT : SIM_INPUT_RIGHT).events;
+	}
+	return sum;
+}
+
+// Soft drops a fresh copy of the state until the piece locks, clears and spawns the next one
+static unsigned long long bench_sim_drop_and_lock(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		SimState state = data->states[i % BENCH_BOARDS];
+		SimStepResult result;
+		do {
+			result = sim_step(&state, SIM_INPUT_DOWN);
+		} while (!(result.events & (SIM_EVENT_LOCKED | SIM_EVENT_GAME_OVER)));
+		sum += result.numClearedRows + state.piece.shape;
+	}
+	return sum;
+}
+
+static unsigned long long bench_sim_hard_drop(BenchData *data, long iterations) {
+	unsigned long long sum = 0;
+	for (long i = 0; i < iterations; i++) {
+		SimState state = data->states[i % BENCH_BOARDS];
+		SimStepResult result = sim_step(&state, SIM_INPUT_HARD_DROP);
+		sum += result.numClearedRows + state.piece.shape;
+	}
+	return sum;
+}
+
+typedef struct {
+	const char *name;
+	BenchFunc func;
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+	{ "board copy", bench_board_copy },
+	{ "find highest full row", bench_highest_full_row },
+	{ "board is empty", bench_is_empty },
+	{ "clear full rows", bench_clear_full_rows },
+	{ "remove row", bench_remove_row },
+	{ "get cell", bench_get_cell },
+	{ "set cell", bench_set_cell },
+	{ "piece overlaps", bench_piece_overlaps },
+	{ "sim rotate", bench_sim_rotate },
+	{ "sim shift", bench_sim_shift },
+	{ "landing row", bench_landing_row },
+	{ "sim drop and lock", bench_sim_drop_and_lock },
+	{ "sim hard drop", bench_sim_hard_drop },
+};
+
+static const int fill_levels[] = { 0, 25, 50, 75, 90 };
+
+int main(int argc, char **argv) {
+	long iterations = 2000000;
+	const char *filter = NULL;
+	BenchData *data = malloc(sizeof(BenchData));
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) iterations = strtol(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-f") == 0) filter = argv[i + 1];
+	}
+
+	if (iterations <= 0) {
+		iterations = 1;
+	}
+
+	printf("iterations: %ld\n", iterations);
+	printf("+-----------------------+--------+-----------+-----------+\n");
+	printf("| benchmark             | fill %% |   ns/op   | allocs/op |\n");
+	printf("+-----------------------+--------+-----------+-----------+\n");
+
+	for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+		if (filter != NULL && strstr(benchmarks[b].name, filter) == NULL) {
+			continue;
+		}
+
+		for (size_t f = 0; f < sizeof(fill_levels) / sizeof(fill_levels[0]); f++) {
+			make_data(data, fill_levels[f]);
+
+			// Warm up caches and branch predictors before timing
+			sink += benchmarks[b].func(data, iterations / 10 + 1);
+			make_data(data, fill_levels[f]);
+
+			unsigned long long allocations_before = allocations;
+			double start = platform_time_seconds();
+			sink += benchmarks[b].func(data, iterations);
+			double seconds = platform_time_seconds() - start;
+			unsigned long long allocated = allocations - allocations_before;
+
+			printf("| %-21s | %6d | %9.2f | %9.3f |\n", benchmarks[b].name, fill_levels[f],
+				seconds * 1e9 / iterations, (double)allocated / iterations);
+		}
+	}
+
+	printf("+-----------------------+--------+-----------+-----------+\n");
+
+	free(data);
+	return 0;
+}
\ No newline at end of file
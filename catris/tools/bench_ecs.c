@@ -0,0 +1,468 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecs.h"
+#include "platform.h"
+#include "prefab.h"
+#include "rng.h"
+#include "scheduler.h"
+#include "transform.h"
+
+// Microbenchmarks for the ECS at 10^3 to 10^6 entities in both storage modes.
+// usage: bench_ecs [-n operations] [-m max entities] [-s sparse|archetype] [-f name filter] [-t threads]
+// Every measurement repeats its benchmark until about n operations ran, at least once.
+// "compose transforms" runs the transform system on the calling thread, "compose transforms mt" on a
+// scheduler with t workers (4 by default). Both check the matrices they composed before timing, the
+// first time with reallocs failing so parallelQuery takes its fallback path. "record commands" replaces
+// every entity through a system's command buffer and checks the result of the first flush. Failed
+// checks fail the run.
+// Three in four entities are sprites (MODEL | TRANSFORM | VERTEX | TEXTURE | SPRITE), the rest only
+// have MODEL | TRANSFORM, so queries have entities to skip. "shuffled" benchmarks visit entities in
+// random order and show the cost of cache misses, compare them with their sequential counterparts.
+// Allocations are counted by wrapping malloc/calloc/realloc at link time (see the Makefile).
+
+#define BENCH_SPRITE_MASK (COMPONENT_MODEL | COMPONENT_TRANSFORM | COMPONENT_VERTEX | COMPONENT_TEXTURE | COMPONENT_SPRITE)
+#define BENCH_ITERATE_MASK (COMPONENT_MODEL | COMPONENT_VERTEX | COMPONENT_TEXTURE | COMPONENT_SPRITE)
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static unsigned long long allocations;
+
+void *__wrap_malloc(size_t size) {
+	allocations++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+static int fail_reallocs; // makes realloc return NULL while set
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	allocations++;
+	if (fail_reallocs) {
+		return NULL;
+	}
+	return __real_realloc(ptr, size);
+}
+
+typedef struct {
+	ECS ecs;
+	unsigned int numEntities;
+	EntityID *entities;
+	unsigned int *order; // a shuffled permutation of the indices into entities
+	Prefab sprite;
+	Prefab plain;
+	QueryID iterateQuery;
+	TransformSystem transforms;
+	int threads; // workers of the mt scheduler
+	// Made by the first run of the benchmarks using them, NULL before
+	Scheduler *serialScheduler;
+	Scheduler *scheduler;
+	Scheduler *commandScheduler;
+} BenchData;
+
+// Runs the benchmark once and adds the operations it did to ops
+typedef unsigned long long (*BenchFunc)(BenchData *data, unsigned long long *ops);
+
+static volatile unsigned long long sink;
+static unsigned int failures;
+
+static void make_prefabs(BenchData *data) {
+	initPrefab(&data->sprite);
+	glm_mat4_identity(((ModelComponent *)setPrefabComponent(&data->sprite, COMPONENT_TYPE_MODEL))->model);
+	initTransform(setPrefabComponent(&data->sprite, COMPONENT_TYPE_TRANSFORM), 1.0f, 2.0f, 0.5f, 1.0f, 1.0f);
+	((VertexComponent *)setPrefabComponent(&data->sprite, COMPONENT_TYPE_VERTEX))->vertices[0] = 1.0f;
+	strcpy(((TextureComponent *)setPrefabComponent(&data->sprite, COMPONENT_TYPE_TEXTURE))->path, "atlas");
+	((SpriteComponent *)setPrefabComponent(&data->sprite, COMPONENT_TYPE_SPRITE))->alpha = 1.0f;
+
+	initPrefab(&data->plain);
+	glm_mat4_identity(((ModelComponent *)setPrefabComponent(&data->plain, COMPONENT_TYPE_MODEL))->model);
+	initTransform(setPrefabComponent(&data->plain, COMPONENT_TYPE_TRANSFORM), 1.0f, 2.0f, 0.5f, 1.0f, 1.0f);
+}
+
+static EntityID make_entity(BenchData *data, unsigned int index) {
+	EntityID id = ENTITY_NONE;
+	instantiatePrefab(&data->ecs, index % 4 == 3 ? &data->plain : &data->sprite, &id, 1);
+	return id;
+}
+
+static void make_data(BenchData *data, EcsStorage storage, unsigned int num_entities) {
+	Rng rng;
+	rng_seed(&rng, num_entities);
+
+	initECS(&data->ecs, storage);
+	data->iterateQuery = registerQuery(&data->ecs, BENCH_ITERATE_MASK, COMPONENT_NONE);
+	data->numEntities = num_entities;
+	data->serialScheduler = NULL;
+	data->scheduler = NULL;
+	data->commandScheduler = NULL;
+
+	for (unsigned int i = 0; i < num_entities; i++) {
+		data->entities[i] = make_entity(data, i);
+		data->order[i] = i;
+	}
+
+	for (unsigned int i = num_entities - 1; i > 0; i--) {
+		unsigned int j = rng_range(&rng, i + 1);
+		unsigned int swap = data->order[i];
+		data->order[i] = data->order[j];
+		data->order[j] = swap;
+	}
+}
+
+// Fills a fresh ECS with entities without components and frees it again
+static unsigned long long bench_create(BenchData *data, unsigned long long *ops) {
+	ECS ecs;
+	unsigned long long sum = 0;
+
+	initECS(&ecs, data->ecs.storage);
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		sum += createEntity(&ecs);
+	}
+	freeECS(&ecs);
+
+	*ops += data->numEntities;
+	return sum;
+}
+
+// Destroys every entity in shuffled order and stamps a replacement from its prefab
+static unsigned long long bench_churn(BenchData *data, unsigned long long *ops) {
+	unsigned long long sum = 0;
+
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		unsigned int index = data->order[i];
+		destroyEntity(&data->ecs, data->entities[index]);
+		data->entities[index] = make_entity(data, index);
+		sum += data->entities[index];
+	}
+
+	*ops += data->numEntities;
+	return sum;
+}
+
+static unsigned long long add_remove(BenchData *data, const unsigned int *order, unsigned long long *ops) {
+	unsigned long long sum = 0;
+
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		EntityID id = data->entities[order != NULL ? order[i] : i];
+		VelocityComponent *velocity = addComponent(&data->ecs, id, COMPONENT_TYPE_VELOCITY);
+		velocity->dx = 1.0f;
+		sum += (unsigned long long)velocity->dx;
+	}
+
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		removeComponent(&data->ecs, data->entities[order != NULL ? order[i] : i], COMPONENT_TYPE_VELOCITY);
+	}
+
+	*ops += 2ull * data->numEntities;
+	return sum;
+}
+
+static unsigned long long bench_add_remove(BenchData *data, unsigned long long *ops) {
+	return add_remove(data, NULL, ops);
+}
+
+static unsigned long long bench_add_remove_shuffled(BenchData *data, unsigned long long *ops) {
+	return add_remove(data, data->order, ops);
+}
+
+static unsigned long long get_models(BenchData *data, const unsigned int *order, unsigned long long *ops) {
+	unsigned long long sum = 0;
+
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		ModelComponent *model = getComponent(&data->ecs, data->entities[order != NULL ? order[i] : i], COMPONENT_TYPE_MODEL);
+		sum += (unsigned long long)model->model[0][0];
+	}
+
+	*ops += data->numEntities;
+	return sum;
+}
+
+static unsigned long long bench_get_component(BenchData *data, unsigned long long *ops) {
+	return get_models(data, NULL, ops);
+}
+
+static unsigned long long bench_get_component_shuffled(BenchData *data, unsigned long long *ops) {
+	return get_models(data, data->order, ops);
+}
+
+// What a render pass reads from every sprite, ops are the entities visited
+static unsigned long long iterate(QueryIterator *it, unsigned long long *ops) {
+	unsigned long long sum = 0;
+
+	while (queryNext(it)) {
+		ModelComponent *models = it->columns[COMPONENT_TYPE_MODEL];
+		VertexComponent *vertices = it->columns[COMPONENT_TYPE_VERTEX];
+		TextureComponent *textures = it->columns[COMPONENT_TYPE_TEXTURE];
+		SpriteComponent *sprites = it->columns[COMPONENT_TYPE_SPRITE];
+
+		for (unsigned int i = 0; i < it->count; i++) {
+			sum += textures[i].textureId + (unsigned long long)(vertices[i].vertices[0] + sprites[i].alpha + models[i].model[3][0]);
+		}
+		*ops += it->count;
+	}
+	return sum;
+}
+
+static unsigned long long bench_iterate(BenchData *data, unsigned long long *ops) {
+	QueryIterator it;
+	queryBegin(&it, &data->ecs, BENCH_ITERATE_MASK, COMPONENT_NONE);
+	return iterate(&it, ops);
+}
+
+static unsigned long long bench_iterate_cached(BenchData *data, unsigned long long *ops) {
+	QueryIterator it;
+	queryBeginCached(&it, &data->ecs, data->iterateQuery);
+	return iterate(&it, ops);
+}
+
+static void clear_models(BenchData *data) {
+	QueryIterator it;
+
+	queryBegin(&it, &data->ecs, COMPONENT_MODEL, COMPONENT_NONE);
+	while (queryNext(&it)) {
+		memset(it.columns[COMPONENT_TYPE_MODEL], 0, it.count * sizeof(ModelComponent));
+	}
+}
+
+static void check_models(BenchData *data, const char *what) {
+	unsigned int mismatches = 0;
+	mat4 expected;
+
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		composeTransform(getComponent(&data->ecs, data->entities[i], COMPONENT_TYPE_TRANSFORM), expected);
+		if (memcmp(expected, getComponent(&data->ecs, data->entities[i], COMPONENT_TYPE_MODEL), sizeof(mat4)) != 0) {
+			mismatches++;
+		}
+	}
+
+	if (mismatches > 0) {
+		printf("FAILED: %s composed %u of %u models wrong\n", what, mismatches, data->numEntities);
+		failures++;
+	}
+}
+
+// Composes every entity's model, ops are the entities composed. The first run makes the scheduler
+// and checks what it composed, with and without reallocs failing.
+static unsigned long long compose(BenchData *data, Scheduler **scheduler, int threads, unsigned long long *ops) {
+	if (*scheduler == NULL) {
+		initTransformSystem(&data->transforms, &data->ecs);
+		*scheduler = createScheduler(&data->ecs, threads);
+		addSystem(*scheduler, "compose transforms", composeTransformsSystem, &data->transforms,
+			COMPONENT_TRANSFORM, COMPONENT_MODEL, SYSTEM_NONE);
+
+		clear_models(data);
+		fail_reallocs = 1;
+		runSystems(*scheduler);
+		fail_reallocs = 0;
+		check_models(data, "compose without memory");
+
+		clear_models(data);
+		data->transforms.composedTick = 0;
+		runSystems(*scheduler);
+		check_models(data, threads == 1 ? "compose" : "compose mt");
+	}
+
+	data->transforms.composedTick = 0;
+	runSystems(*scheduler);
+
+	*ops += data->numEntities;
+	return data->transforms.composedTick;
+}
+
+static unsigned long long bench_compose(BenchData *data, unsigned long long *ops) {
+	return compose(data, &data->serialScheduler, 1, ops);
+}
+
+static unsigned long long bench_compose_mt(BenchData *data, unsigned long long *ops) {
+	return compose(data, &data->scheduler, data->threads, ops);
+}
+
+// Replaces every entity with a plain one through the command buffer, the old entity's transform moves
+// one unit to tell them apart
+static void record_commands_system(ECS *ecs, Scheduler *scheduler, CommandBuffer *commands, void *arg) {
+	QueryIterator it;
+	(void)scheduler;
+	(void)arg;
+
+	queryBegin(&it, ecs, COMPONENT_MODEL | COMPONENT_TRANSFORM, COMPONENT_NONE);
+	while (queryNext(&it)) {
+		const ModelComponent *models = it.columns[COMPONENT_TYPE_MODEL];
+		const TransformComponent *transforms = it.columns[COMPONENT_TYPE_TRANSFORM];
+
+		for (unsigned int i = 0; i < it.count; i++) {
+			TransformComponent moved = transforms[i];
+			EntityID pending = commandCreateEntity(commands);
+
+			moved.x += 1.0f;
+			commandAddComponent(commands, pending, COMPONENT_TYPE_MODEL, &models[i]);
+			commandAddComponent(commands, pending, COMPONENT_TYPE_TRANSFORM, &moved);
+			commandDestroyEntity(commands, it.entities[i]);
+		}
+	}
+}
+
+static void check_commands(BenchData *data) {
+	unsigned int errors = 0;
+	unsigned int count = 0;
+	QueryIterator it;
+
+	for (unsigned int i = 0; i < data->numEntities; i++) {
+		if (isEntityAlive(&data->ecs, data->entities[i])) {
+			errors++;
+		}
+	}
+
+	queryBegin(&it, &data->ecs, COMPONENT_MODEL | COMPONENT_TRANSFORM, COMPONENT_NONE);
+	while (queryNext(&it)) {
+		const TransformComponent *transforms = it.columns[COMPONENT_TYPE_TRANSFORM];
+
+		for (unsigned int i = 0; i < it.count; i++) {
+			if (transforms[i].x != 2.0f || hasComponents(&data->ecs, it.entities[i], COMPONENT_SPRITE)) {
+				errors++;
+			}
+		}
+		count += it.count;
+	}
+
+	if (errors > 0 || count != data->numEntities || data->ecs.numAlive != data->numEntities) {
+		printf("FAILED: record commands, %u wrong entities, %u of %u made\n", errors, count, data->numEntities);
+		failures++;
+	}
+}
+
+static unsigned long long bench_record_commands(BenchData *data, unsigned long long *ops) {
+	if (data->commandScheduler == NULL) {
+		data->commandScheduler = createScheduler(&data->ecs, data->threads);
+		addSystem(data->commandScheduler, "record commands", record_commands_system, NULL,
+			COMPONENT_MODEL | COMPONENT_TRANSFORM, COMPONENT_NONE, SYSTEM_NONE);
+
+		runSystems(data->commandScheduler);
+		check_commands(data);
+	}
+	else {
+		runSystems(data->commandScheduler);
+	}
+
+	*ops += data->numEntities;
+	return data->ecs.numAlive;
+}
+
+static void free_schedulers(BenchData *data) {
+	Scheduler *schedulers[] = { data->serialScheduler, data->scheduler, data->commandScheduler };
+
+	for (size_t i = 0; i < sizeof(schedulers) / sizeof(schedulers[0]); i++) {
+		if (schedulers[i] != NULL) {
+			destroyScheduler(schedulers[i]);
+		}
+	}
+}
+
+typedef struct {
+	const char *name;
+	BenchFunc func;
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+	{ "create", bench_create },
+	{ "destroy + instantiate", bench_churn },
+	{ "add/remove", bench_add_remove },
+	{ "add/remove shuffled", bench_add_remove_shuffled },
+	{ "get component", bench_get_component },
+	{ "get component shuffled", bench_get_component_shuffled },
+	{ "iterate query", bench_iterate },
+	{ "iterate cached query", bench_iterate_cached },
+	{ "compose transforms", bench_compose },
+	{ "compose transforms mt", bench_compose_mt },
+	{ "record commands", bench_record_commands },
+};
+
+static const unsigned int entity_counts[] = { 1000, 10000, 100000, 1000000 };
+static const EcsStorage storages[] = { ECS_STORAGE_SPARSE, ECS_STORAGE_ARCHETYPE };
+static const char *storage_names[] = { "sparse", "archetype" };
+
+int main(int argc, char **argv) {
+	unsigned long long operations = 2000000;
+	unsigned int max_entities = 1000000;
+	const char *storage_filter = NULL;
+	const char *filter = NULL;
+	BenchData data;
+
+	data.threads = 4;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) operations = strtoull(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-m") == 0) max_entities = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-s") == 0) storage_filter = argv[i + 1];
+		else if (strcmp(argv[i], "-f") == 0) filter = argv[i + 1];
+		else if (strcmp(argv[i], "-t") == 0) data.threads = atoi(argv[i + 1]);
+	}
+
+	data.entities = malloc(max_entities * sizeof(EntityID));
+	data.order = malloc(max_entities * sizeof(unsigned int));
+	make_prefabs(&data);
+
+	printf("operations: %llu\n", operations);
+	printf("+------------------------+-----------+----------+-----------+-----------+-----------+\n");
+	printf("| benchmark              | storage   | entities |   ns/op   |  Mops/s   | allocs/op |\n");
+	printf("+------------------------+-----------+----------+-----------+-----------+-----------+\n");
+
+	for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+		if (filter != NULL && strstr(benchmarks[b].name, filter) == NULL) {
+			continue;
+		}
+
+		for (size_t s = 0; s < sizeof(storages) / sizeof(storages[0]); s++) {
+			if (storage_filter != NULL && strcmp(storage_filter, storage_names[s]) != 0) {
+				continue;
+			}
+
+			for (size_t c = 0; c < sizeof(entity_counts) / sizeof(entity_counts[0]) && entity_counts[c] <= max_entities; c++) {
+				unsigned long long passes = (operations + entity_counts[c] - 1) / entity_counts[c];
+				unsigned long long ops = 0;
+
+				make_data(&data, storages[s], entity_counts[c]);
+
+				// Warm up caches and branch predictors before timing
+				sink += benchmarks[b].func(&data, &ops);
+				ops = 0;
+
+				unsigned long long allocations_before = allocations;
+				double start = platform_time_seconds();
+				for (unsigned long long pass = 0; pass < passes; pass++) {
+					sink += benchmarks[b].func(&data, &ops);
+				}
+				double seconds = platform_time_seconds() - start;
+				unsigned long long allocated = allocations - allocations_before;
+
+				if (ops == 0) {
+					ops = 1;
+				}
+				printf("| %-22s | %-9s | %8u | %9.2f | %9.2f | %9.3f |\n", benchmarks[b].name, storage_names[s], entity_counts[c],
+					seconds * 1e9 / ops, ops / seconds / 1e6, (double)allocated / ops);
+				fflush(stdout);
+
+				free_schedulers(&data);
+				freeECS(&data.ecs);
+			}
+		}
+	}
+
+	printf("+------------------------+-----------+----------+-----------+-----------+-----------+\n");
+
+	freePrefab(&data.sprite);
+	freePrefab(&data.plain);
+	free(data.entities);
+	free(data.order);
+
+	if (failures > 0) {
+		printf("%u checks FAILED\n", failures);
+		return 1;
+	}
+	return 0;
+}
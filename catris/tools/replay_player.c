@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "replay.h"
+
+// Replays recorded games headless at full speed, checks every keyframe against the
+// re-simulated state and the final result against the header.
+// usage: replay_player [-n input index] file...
+// with -n the board right before that input is printed instead, using keyframe seeking
+
+static int states_match(const SimState *a, const SimState *b) {
+	return memcmp(a->board.rows, b->board.rows, sizeof(a->board.rows)) == 0
+		&& memcmp(&a->piece, &b->piece, sizeof(a->piece)) == 0
+		&& memcmp(a->rng.s, b->rng.s, sizeof(a->rng.s)) == 0
+		&& a->pieces == b->pieces && a->lines == b->lines && a->gameOver == b->gameOver;
+}
+
+// Returns the number of mismatches found
+static int play_replay(const Replay *replay, const char *path) {
+	const ReplayHeader *header = replay->header;
+	SimState state;
+	SimState expected;
+	uint32_t keyframe = 0;
+	int mismatches = 0;
+
+	sim_init(&state, header->seed);
+
+	for (uint32_t i = 0; i <= header->numInputs; i++) {
+		if (keyframe < header->numKeyframes && replay->keyframes[keyframe].inputIndex == i) {
+			expected = state;
+			replay_keyframe_state(&replay->keyframes[keyframe], &expected);
+			if (!states_match(&state, &expected)) {
+				printf("%s: keyframe %u at input %u does not match the simulation\n", path, keyframe, i);
+				mismatches++;
+			}
+			keyframe++;
+		}
+
+		if (i < header->numInputs) {
+			sim_step(&state, replay_input(replay, i));
+		}
+	}
+
+	if (state.pieces != header->pieces || state.lines != header->lines) {
+		printf("%s: replay ended with %u pieces %u lines, header says %u pieces %u lines\n",
+			path, state.pieces, state.lines, header->pieces, header->lines);
+		mismatches++;
+	}
+
+	return mismatches;
+}
+
+int main(int argc, char **argv) {
+	long long seekIndex = -1;
+	int numFiles = 0;
+	int failed = 0;
+	unsigned long long inputs = 0;
+	double start;
+	double seconds;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			seekIndex = strtoll(argv[++i], NULL, 10);
+		}
+		else {
+			argv[++numFiles] = argv[i];
+		}
+	}
+
+	if (numFiles == 0) {
+		printf("usage: replay_player [-n input index] file...\n");
+		return 1;
+	}
+
+	start = platform_time_seconds();
+
+	for (int i = 1; i <= numFiles; i++) {
+		Replay replay;
+
+		if (!replay_open(&replay, argv[i])) {
+			failed++;
+			continue;
+		}
+
+		if (seekIndex >= 0) {
+			SimState state;
+			uint32_t index = seekIndex > replay.header->numInputs ? replay.header->numInputs : (uint32_t)seekIndex;
+
+			replay_seek(&replay, &state, index);
+			printf("%s: input %u of %u, %u ms, pieces: %u, lines: %u\n", argv[i], index, replay.header->numInputs,
+				index < replay.header->numInputs ? replay_input_time(&replay, index) : 0, state.pieces, state.lines);
+			board_print(&state.board);
+		}
+		else if (play_replay(&replay, argv[i]) > 0) {
+			failed++;
+		}
+
+		inputs += replay.header->numInputs;
+		replay_close(&replay);
+	}
+
+	seconds = platform_time_seconds() - start;
+	printf("replays: %d, failed: %d, inputs: %llu\n", numFiles, failed, inputs);
+	printf("%.3f s, %.0f replays/s, %.0f inputs/s\n", seconds, numFiles / seconds, inputs / seconds);
+
+	return failed > 0;
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "policy.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+
+// Plays many independent games in parallel on the headless simulation and reports throughput
+// usage: selfplay [-g games] [-t threads] [-s seed] [-p random|greedy] [-m max pieces per game] [-b games per task] [-r replay dir] [-l snapshot]
+// game N is seeded with seed + N, so totals are the same for any thread count
+// with -r every game is saved as <replay dir>/game_N.replay, input times are step numbers
+// with -l every game starts from the snapshot's position, only its piece generator is reseeded.
+// -m then caps the pieces played after the snapshot, and totals only count what each game added to it.
+// Replays always start from a new game, so -l turns -r off.
+
+typedef struct {
+	unsigned long long games;
+	unsigned long long pieces;
+	unsigned long long lines;
+	unsigned long long steps;
+	char padding[PLATFORM_CACHE_LINE - 4 * sizeof(unsigned long long)]; // one cache line per worker, the array is line aligned
+} WorkerTotals;
+
+typedef struct {
+	const SimPolicy *policy;
+	WorkerTotals *totals;
+	const char *replayDir;
+	const SimState *start; // NULL starts new games
+	unsigned long long seed;
+	unsigned int maxPieces;
+	unsigned int firstGame;
+	unsigned int numGames;
+} GameBatch;
+
+static void play_batch(void *arg) {
+	GameBatch *batch = arg;
+	WorkerTotals *totals = &batch->totals[thread_pool_worker_index()];
+	void *context = malloc(batch->policy->contextSize);
+	SimState state;
+	ReplayRecorder recorder;
+	char path[1024];
+	unsigned int start_pieces = batch->start != NULL ? batch->start->pieces : 0;
+	unsigned int start_lines = batch->start != NULL ? batch->start->lines : 0;
+
+	for (unsigned int game = batch->firstGame; game < batch->firstGame + batch->numGames; game++) {
+		memset(context, 0, batch->policy->contextSize);
+		batch->policy->reset(context, batch->seed + game);
+		if (batch->start != NULL) {
+			state = *batch->start;
+			rng_seed(&state.rng, batch->seed + game);
+		}
+		else {
+			sim_init(&state, batch->seed + game);
+		}
+		replay_recorder_init(&recorder, batch->seed + game, REPLAY_DEFAULT_KEYFRAME_INTERVAL);
+
+		for (uint32_t step = 0; !state.gameOver && state.pieces - start_pieces < batch->maxPieces; step++) {
+			SimInput input = batch->policy->next_input(context, &state);
+			if (batch->replayDir != NULL) {
+				replay_recorder_add(&recorder, &state, input, step);
+			}
+			sim_step(&state, input);
+			totals->steps++;
+		}
+
+		if (batch->replayDir != NULL) {
+			snprintf(path, sizeof(path), "%s/game_%u.replay", batch->replayDir, game);
+			replay_recorder_save(&recorder, &state, path);
+			replay_recorder_free(&recorder);
+		}
+
+		totals->games++;
+		totals->pieces += state.pieces - start_pieces;
+		totals->lines += state.lines - start_lines;
+	}
+
+	free(context);
+}
+
+int main(int argc, char **argv) {
+	unsigned int games = 1000;
+	int threads = 0;
+	unsigned long long seed = 1;
+	unsigned int max_pieces = 1000;
+	unsigned int batch_size = 16;
+	const SimPolicy *policy = &sim_policy_greedy;
+	const char *replay_dir = NULL;
+	const char *snapshot_path = NULL;
+	SimState start_state;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-g") == 0) games = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-t") == 0) threads = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-s") == 0) seed = strtoull(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-m") == 0) max_pieces = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-b") == 0) batch_size = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-r") == 0) replay_dir = argv[i + 1];
+		else if (strcmp(argv[i], "-l") == 0) snapshot_path = argv[i + 1];
+		else if (strcmp(argv[i], "-p") == 0) {
+			policy = sim_policy_find(argv[i + 1]);
+			if (policy == NULL) {
+				printf("Unknown policy %s\n", argv[i + 1]);
+				return 1;
+			}
+		}
+	}
+
+	if (batch_size == 0) {
+		batch_size = 1;
+	}
+
+	if (snapshot_path != NULL) {
+		Snapshot snapshot;
+		if (!snapshot_open(&snapshot, snapshot_path)) {
+			return 1;
+		}
+		snapshot_state(&snapshot, &start_state);
+		snapshot_close(&snapshot);
+
+		if (replay_dir != NULL) {
+			printf("Replays can't start from a snapshot, not saving them\n");
+			replay_dir = NULL;
+		}
+	}
+
+	ThreadPool *pool = thread_pool_create(threads);
+	WorkerTotals *totals = platform_aligned_calloc(PLATFORM_CACHE_LINE, pool->numThreads * sizeof(WorkerTotals));
+	unsigned int num_batches = (games + batch_size - 1) / batch_size;
+	GameBatch *batches = malloc(num_batches * sizeof(GameBatch));
+
+	double start = platform_time_seconds();
+
+	for (unsigned int i = 0; i < num_batches; i++) {
+		batches[i].policy = policy;
+		batches[i].totals = totals;
+		batches[i].replayDir = replay_dir;
+		batches[i].start = snapshot_path != NULL ? &start_state : NULL;
+		batches[i].seed = seed;
+		batches[i].maxPieces = max_pieces;
+		batches[i].firstGame = i * batch_size;
+		batches[i].numGames = (i + 1) * batch_size <= games ? batch_size : games - i * batch_size;
+		thread_pool_submit(pool, play_batch, &batches[i]);
+	}
+	thread_pool_wait(pool);
+
+	double seconds = platform_time_seconds() - start;
+	if (seconds <= 0.0) {
+		seconds = 1e-9;
+	}
+
+	WorkerTotals sum;
+	memset(&sum, 0, sizeof(sum));
+	for (int i = 0; i < pool->numThreads; i++) {
+		sum.games += totals[i].games;
+		sum.pieces += totals[i].pieces;
+		sum.lines += totals[i].lines;
+		sum.steps += totals[i].steps;
+	}
+
+	printf("policy: %s, threads: %d, games: %llu, steps: %llu, pieces: %llu, lines: %llu\n",
+		policy->name, pool->numThreads, sum.games, sum.steps, sum.pieces, sum.lines);
+	printf("%.3f s, %.0f games/s, %.0f pieces/s, %.0f lines/s, %.0f steps/s\n",
+		seconds, sum.games / seconds, sum.pieces / seconds, sum.lines / seconds, sum.steps / seconds);
+
+	printf("+--------+--------+---------+--------+------------+\n");
+	printf("| thread | busy %% |  tasks  | stolen |   pieces   |\n");
+	printf("+--------+--------+---------+--------+------------+\n");
+	for (int i = 0; i < pool->numThreads; i++) {
+		printf("| %6d | %6.1f | %7llu | %6llu | %10llu |\n", i, 100.0 * pool->stats[i].busySeconds / seconds,
+			pool->stats[i].tasksRun, pool->stats[i].tasksStolen, totals[i].pieces);
+	}
+	printf("+--------+--------+---------+--------+------------+\n");
+
+	thread_pool_destroy(pool);
+	free(batches);
+	platform_aligned_free(totals);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include <math.h>
+
+#include "transform.h"
+
+void initTransform(TransformComponent* transform, float x, float y, float rotation, float scale_x, float scale_y) {
+	transform->x = x;
+	transform->y = y;
+	transform->rotation = rotation;
+	transform->scaleX = scale_x;
+	transform->scaleY = scale_y;
+}
+
+void composeTransform(const TransformComponent* transform, mat4 model) {
+	float c = 1.0f;
+	float s = 0.0f;
+
+	if (transform->rotation != 0.0f) {
+		c = cosf(transform->rotation);
+		s = sinf(transform->rotation);
+	}
+
+	model[0][0] = c * transform->scaleX;
+	model[0][1] = s * transform->scaleX;
+	model[0][2] = 0.0f;
+	model[0][3] = 0.0f;
+	model[1][0] = -s * transform->scaleY;
+	model[1][1] = c * transform->scaleY;
+	model[1][2] = 0.0f;
+	model[1][3] = 0.0f;
+	model[2][0] = 0.0f;
+	model[2][1] = 0.0f;
+	model[2][2] = 1.0f;
+	model[2][3] = 0.0f;
+	model[3][0] = transform->x;
+	model[3][1] = transform->y;
+	model[3][2] = 0.0f;
+	model[3][3] = 1.0f;
+}
+
+static HierarchyComponent* addHierarchy(ECS* ecs, EntityID id) {
+	if (!hasComponents(ecs, id, COMPONENT_HIERARCHY)) {
+		HierarchyComponent* hierarchy = addComponent(ecs, id, COMPONENT_TYPE_HIERARCHY);
+		if (hierarchy == NULL) {
+			return NULL;
+		}
+		hierarchy->parent = ENTITY_NONE;
+		hierarchy->firstChild = ENTITY_NONE;
+		hierarchy->nextSibling = ENTITY_NONE;
+	}
+	return getComponent(ecs, id, COMPONENT_TYPE_HIERARCHY);
+}
+
+void setTransformParent(ECS* ecs, EntityID child, EntityID parent) {
+	// Adding a component can move other entities' components, fetch pointers once both are added
+	if (addHierarchy(ecs, child) == NULL || (parent != ENTITY_NONE && addHierarchy(ecs, parent) == NULL)) {
+		return;
+	}
+
+	HierarchyComponent* node = getComponent(ecs, child, COMPONENT_TYPE_HIERARCHY);
+	if (node->parent == parent) {
+		return;
+	}
+
+	if (node->parent != ENTITY_NONE) {
+		HierarchyComponent* old_parent = getComponent(ecs, node->parent, COMPONENT_TYPE_HIERARCHY);
+		EntityID* link = &old_parent->firstChild;
+		while (*link != child) {
+			link = &((HierarchyComponent*)getComponent(ecs, *link, COMPONENT_TYPE_HIERARCHY))->nextSibling;
+		}
+		*link = node->nextSibling;
+	}
+
+	node->parent = parent;
+	node->nextSibling = ENTITY_NONE;
+	if (parent != ENTITY_NONE) {
+		HierarchyComponent* new_parent = getComponent(ecs, parent, COMPONENT_TYPE_HIERARCHY);
+		node->nextSibling = new_parent->firstChild;
+		new_parent->firstChild = child;
+	}
+
+	// Same local transform, different world matrix
+	markComponentChanged(ecs, child, COMPONENT_TYPE_TRANSFORM);
+}
+
+void initTransformSystem(TransformSystem* system, ECS* ecs) {
+	system->composedTick = 0;
+	system->query = registerQuery(ecs, COMPONENT_MODEL | COMPONENT_TRANSFORM, COMPONENT_HIERARCHY);
+	system->hierarchyQuery = registerQuery(ecs, COMPONENT_MODEL | COMPONENT_TRANSFORM | COMPONENT_HIERARCHY, COMPONENT_NONE);
+}
+
+// Depth first, a child is recomposed when its own transform or any ancestor's changed
+static void composeChildren(ECS* ecs, EntityID parent, bool parent_changed, unsigned int since_tick) {
+	EntityID child = ((HierarchyComponent*)getComponent(ecs, parent, COMPONENT_TYPE_HIERARCHY))->firstChild;
+
+	while (child != ENTITY_NONE) {
+		bool changed = parent_changed || getComponentTick(ecs, child, COMPONENT_TYPE_TRANSFORM) > since_tick;
+
+		if (changed) {
+			ModelComponent* parent_model = getComponent(ecs, parent, COMPONENT_TYPE_MODEL);
+			ModelComponent* model = getComponent(ecs, child, COMPONENT_TYPE_MODEL);
+			mat4 local;
+			composeTransform(getComponent(ecs, child, COMPONENT_TYPE_TRANSFORM), local);
+			glm_mat4_mul(parent_model->model, local, model->model);
+			markComponentChanged(ecs, child, COMPONENT_TYPE_MODEL);
+		}
+
+		composeChildren(ecs, child, changed, since_tick);
+		child = ((HierarchyComponent*)getComponent(ecs, child, COMPONENT_TYPE_HIERARCHY))->nextSibling;
+	}
+}
+
+static void composeSpan(const QueryIterator* span, void* arg) {
+	const TransformComponent* transforms = span->columns[COMPONENT_TYPE_TRANSFORM];
+	ModelComponent* models = span->columns[COMPONENT_TYPE_MODEL];
+	(void)arg;
+
+	for (unsigned int i = 0; i < span->count; ++i) {
+		composeTransform(&transforms[i], models[i].model);
+	}
+}
+
+// Outside of hierarchies only the transforms that moved this frame are visited, their matrices are
+// composed in parallel. Marking a model changed writes its chunk's shared tick, so that's done on the
+// system's thread afterwards. Trees are walked whole on the system's thread but only their changed
+// branches are recomposed.
+void composeTransformsSystem(ECS* ecs, Scheduler* scheduler, CommandBuffer* commands, void* arg) {
+	TransformSystem* system = arg;
+	QueryIterator it;
+	(void)commands;
+
+	queryBeginCachedChanged(&it, ecs, system->query, COMPONENT_TRANSFORM, system->composedTick);
+	parallelQuery(scheduler, &it, composeSpan, NULL);
+
+	// Composing doesn't touch transform ticks, the same query visits the same entities again
+	queryBeginCachedChanged(&it, ecs, system->query, COMPONENT_TRANSFORM, system->composedTick);
+	while (queryNext(&it)) {
+		for (unsigned int i = 0; i < it.count; ++i) {
+			markComponentChanged(ecs, it.entities[i], COMPONENT_TYPE_MODEL);
+		}
+	}
+
+	// Trees are walked from their roots so parents are always composed before their children
+	queryBeginCached(&it, ecs, system->hierarchyQuery);
+	while (queryNext(&it)) {
+		const TransformComponent* transforms = it.columns[COMPONENT_TYPE_TRANSFORM];
+		ModelComponent* models = it.columns[COMPONENT_TYPE_MODEL];
+		const HierarchyComponent* hierarchies = it.columns[COMPONENT_TYPE_HIERARCHY];
+
+		for (unsigned int i = 0; i < it.count; ++i) {
+			if (hierarchies[i].parent != ENTITY_NONE) {
+				continue;
+			}
+
+			bool changed = getComponentTick(ecs, it.entities[i], COMPONENT_TYPE_TRANSFORM) > system->composedTick;
+			if (changed) {
+				composeTransform(&transforms[i], models[i].model);
+				markComponentChanged(ecs, it.entities[i], COMPONENT_TYPE_MODEL);
+			}
+			composeChildren(ecs, it.entities[i], changed, system->composedTick);
+		}
+	}
+
+	system->composedTick = ecs->changeTick;
+}
@@ -0,0 +1,29 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "ecs.h"
+#include "scheduler.h"
+
+void initTransform(TransformComponent* transform, float x, float y, float rotation, float scale_x, float scale_y);
+// model = translate * rotate * scale, written out directly instead of multiplying three matrices
+void composeTransform(const TransformComponent* transform, mat4 model);
+
+// Makes child's transform relative to parent, ENTITY_NONE detaches it. Both need a TransformComponent
+// and a ModelComponent, HierarchyComponents are added as needed. The parent must not be one of the
+// child's descendants. Detach entities before destroying them, links aren't cleaned up.
+void setTransformParent(ECS* ecs, EntityID child, EntityID parent);
+
+// Recomposes the ModelComponent of every entity whose TransformComponent changed since the system's
+// last run, the rest keep their matrix. Children are recomposed after their parent, when either
+// changed. Entities outside hierarchies are composed in parallel on the scheduler's workers.
+// Register it before the systems reading the models.
+typedef struct {
+	unsigned int composedTick; // change tick of the last run, 0 composes everything
+	QueryID query; // MODEL | TRANSFORM outside any hierarchy
+	QueryID hierarchyQuery; // MODEL | TRANSFORM | HIERARCHY
+} TransformSystem;
+
+void initTransformSystem(TransformSystem* system, ECS* ecs);
+void composeTransformsSystem(ECS* ecs, Scheduler* scheduler, CommandBuffer* commands, void* arg);
+
+#endif